@@ -0,0 +1,66 @@
+#pragma once
+
+#include "image_splitter.h"
+#include "monitor_info.h"
+#include <QString>
+#include <QStringList>
+
+namespace WallpaperCore {
+
+// Totals of one BatchSplitter::run(). Stage times are summed over all
+// workers, so with several threads they exceed the wall time.
+struct BatchStats {
+    int images = 0;         // Inputs given
+    int split = 0;          // Inputs decoded and split
+    int upToDate = 0;       // Inputs whose outputs were already cached
+    int failed = 0;
+    qint64 inputBytes = 0;  // File size of the inputs that were split
+    qint64 outputBytes = 0; // Size of the outputs written
+    qint64 decodeNs = 0;
+    qint64 scaleNs = 0;
+    qint64 encodeNs = 0;
+    qint64 wallNs = 0;
+};
+
+// Splits many files for one layout in a single pass. Every (image, monitor)
+// pair is a task in one shared thread pool, so workers move on to the next
+// image's monitors instead of idling while the slowest monitor of an image
+// finishes. At most maxDecodedImages() sources are held decoded at once.
+//
+// Outputs go to the split cache like splitImage() would write them, so an
+// input that is already split with the current settings is skipped and a
+// later splitImage() of any input is a cache hit. The cache is evicted once
+// at the end rather than after every image; use a cache limit of 0 to keep
+// every split of a large batch.
+class BatchSplitter : public ImageSplitter {
+public:
+    // Two sources in flight keep the pool busy across image boundaries
+    static constexpr int DefaultMaxDecodedImages = 2;
+
+    BatchSplitter();
+
+    // Ceiling on decoded sources held at once; each is freed after its last
+    // monitor is written
+    void setMaxDecodedImages(int images) { m_maxDecodedImages = qMax(1, images); }
+    int maxDecodedImages() const { return m_maxDecodedImages; }
+
+    // Split every input for monitors into outputDir. Returns false if any
+    // input failed; the others are still split.
+    bool run(const QStringList& inputPaths,
+             const MonitorList& monitors,
+             const QString& outputDir);
+
+    // Totals of the most recent run()
+    const BatchStats& stats() const { return m_stats; }
+
+    // Inputs named by a directory (every readable image file in it, sorted
+    // by name) or by a text file listing one path per line. Relative paths
+    // in a list are resolved against the list's directory.
+    static QStringList collectInputs(const QString& dirOrList);
+
+private:
+    int m_maxDecodedImages;
+    BatchStats m_stats;
+};
+
+} // namespace WallpaperCore
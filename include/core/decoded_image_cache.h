@@ -0,0 +1,75 @@
+#pragma once
+
+#include <QByteArray>
+#include <QImage>
+#include <QSize>
+#include <QString>
+
+namespace WallpaperCore {
+
+// Disk cache of decoded source images, so re-splitting a source after a
+// layout change or a monitor toggle skips the decode. Each entry is a raw
+// pixel file, <key>.pixels, holding a one-page header (format, size, stride
+// and the source hash) followed by page-aligned scanlines. Entries are
+// memory-mapped read-only on load, so cropping from a cached source only
+// touches the pages of the rows it needs, straight from the page cache.
+//
+// Like SplitCache, recency is kept in file modification times, and the
+// least recently used entries are deleted once the directory's entries
+// exceed the size limit. Files are in native byte order and only meant to
+// be read on the machine that wrote them.
+//
+// Decoding a source whole so it can be stored costs the region decode a
+// first split would otherwise use, so only sources split before are
+// stored. A split is noted as an empty <key>.seen marker; only the
+// MaxMarkers most recently split sources keep theirs.
+class DecodedImageCache {
+public:
+    static constexpr qint64 DefaultMaxBytes = qint64(1024) << 20;
+    static constexpr int MaxMarkers = 1024;
+
+    explicit DecodedImageCache(const QString& directory, qint64 maxBytes = DefaultMaxBytes);
+
+    // Cache key of a source (see SplitCache::fileFingerprint) decoded at
+    // decodeSize, which differs from the source size for scaled decodes
+    static QByteArray sourceHash(const QByteArray& sourceId, const QSize& decodeSize);
+
+    // Whether a file name belongs to a cached decoded image
+    static bool isCacheFileName(const QString& fileName);
+
+    QString directory() const { return m_directory; }
+    qint64 maxBytes() const { return m_maxBytes; }
+
+    // Read-only image mapped from the entry for hash, or a null image if
+    // there is none (or it is damaged). Pixels stay mapped for as long as
+    // any copy of the image lives; writing to it detaches a private copy.
+    QImage load(const QByteArray& hash);
+
+    // Write image as the entry for hash, then evict older entries. Images
+    // larger than the size limit and indexed images are not cached.
+    bool store(const QByteArray& hash, const QImage& image);
+
+    // Note that the source with hash is being split. Returns whether it
+    // was split before, i.e. whether storing it is likely to pay off.
+    bool noteSplit(const QByteArray& hash);
+
+    // Delete least recently used entries until the cache fits its size
+    // limit. keepHash (normally the entry just written) is never evicted.
+    void evict(const QByteArray& keepHash = QByteArray());
+
+    // Total size of all cached decoded images
+    qint64 totalBytes() const;
+
+    void clear();
+
+private:
+    QString filePath(const QByteArray& hash) const;
+
+    // Delete the least recently split sources' markers beyond MaxMarkers
+    void pruneMarkers();
+
+    QString m_directory;
+    qint64 m_maxBytes;
+};
+
+} // namespace WallpaperCore
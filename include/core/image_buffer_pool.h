@@ -0,0 +1,41 @@
+#pragma once
+
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QSize>
+#include <vector>
+
+namespace WallpaperCore {
+
+// Thread-safe pool of image buffers bucketed by size and format. Split
+// outputs have the same size on every wallpaper change, so recycling them
+// avoids two large transient allocations per monitor per change.
+class ImageBufferPool {
+public:
+    static constexpr qint64 DefaultMaxBytes = qint64(256) << 20;
+
+    explicit ImageBufferPool(qint64 maxBytes = DefaultMaxBytes, int maxBuffersPerBucket = 4);
+
+    // Return a pooled buffer of this size and format, or a new one. The
+    // contents are undefined.
+    QImage acquire(const QSize& size, QImage::Format format);
+
+    // Give a buffer back. Buffers that are still shared with another QImage
+    // or would exceed the byte limit are simply dropped.
+    void release(QImage&& image);
+
+    void clear();
+    qint64 pooledBytes() const;
+
+private:
+    static quint64 bucketKey(const QSize& size, QImage::Format format);
+
+    mutable QMutex m_mutex;
+    qint64 m_maxBytes;
+    int m_maxBuffersPerBucket;
+    qint64 m_pooledBytes;
+    QHash<quint64, std::vector<QImage>> m_buckets;
+};
+
+} // namespace WallpaperCore
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <QImage>
+#include <QString>
+
+class QIODevice;
+
+namespace WallpaperCore {
+
+// File formats split images can be written in. Split outputs are only read
+// back once by the local desktop, so the uncompressed and lightly
+// compressed formats trade disk space for much cheaper encoding.
+enum class OutputFormat {
+    Jpeg,       // Lossy, smallest files, slowest to encode
+    Png,        // Lossless, low zlib compression level
+    Bmp,        // Uncompressed
+    Ppm,        // Uncompressed binary PPM (P6)
+    Qoi         // Lossless "Quite OK Image" format, read via KImageFormats
+};
+
+// Chroma subsampling of JPEG outputs
+enum class ChromaSubsampling {
+    S444,       // Full chroma resolution
+    S422,       // Half horizontal chroma resolution
+    S420        // Half horizontal and vertical chroma resolution
+};
+
+// Speed/quality settings for JPEG outputs. Subsampling and DCT choice are
+// only honoured by the libjpeg-turbo backend; Qt's writer always uses its
+// own defaults for them.
+struct JpegOptions {
+    ChromaSubsampling subsampling = ChromaSubsampling::S420;
+    bool fastDct = false;       // Integer fast DCT instead of the accurate one
+                                // (faster, slightly lower quality)
+    bool progressive = false;   // Progressive instead of baseline scans
+};
+
+// Writes split images in any OutputFormat. JPEG goes through libjpeg-turbo
+// when the build has it and through Qt otherwise. PNG, BMP and PPM use Qt's
+// image writers; QOI has its own encoder since Qt ships no QOI writer.
+class ImageEncoder {
+public:
+    // Write an image to a device. quality < 0 uses defaultQuality(format);
+    // it is ignored by the uncompressed formats and QOI.
+    static bool write(const QImage& image, QIODevice* device,
+                      OutputFormat format, int quality = -1,
+                      const JpegOptions& jpegOptions = JpegOptions());
+
+    // Write an image to a file
+    static bool save(const QImage& image, const QString& path,
+                     OutputFormat format, int quality = -1,
+                     const JpegOptions& jpegOptions = JpegOptions());
+
+    // Whether JPEG images are encoded and decoded with libjpeg-turbo
+    static bool hasTurboJpeg();
+
+    // Encode an image as QOI (https://qoiformat.org)
+    static bool writeQoi(const QImage& image, QIODevice* device);
+
+    // Quality used when none is given: 95 for JPEG, 80 for PNG (zlib level 1)
+    static int defaultQuality(OutputFormat format);
+
+    // File name extension without the dot ("jpg", "png", "bmp", "ppm", "qoi")
+    static QString extension(OutputFormat format);
+
+    // Format names as used on the command line ("jpeg", "png", "bmp", "ppm", "qoi")
+    static QString formatName(OutputFormat format);
+    static bool parseFormat(const QString& name, OutputFormat* format);
+
+    // Subsampling names as used on the command line ("444", "422", "420")
+    static QString subsamplingName(ChromaSubsampling subsampling);
+    static bool parseSubsampling(const QString& name, ChromaSubsampling* subsampling);
+};
+
+} // namespace WallpaperCore
@@ -1,35 +1,309 @@
 #pragma once
 
+#include "decoded_image_cache.h"
+#include "image_buffer_pool.h"
+#include "image_encoder.h"
 #include "monitor_info.h"
+#include "resampler.h"
+#include "split_cache.h"
+#include "split_plan.h"
 #include <QString>
+#include <QImage>
 #include <QSize>
 #include <QRect>
+#include <atomic>
+#include <functional>
+#include <memory>
 #include <vector>
 
+class QImageReader;
+class QThreadPool;
+
 namespace WallpaperCore {
 
+namespace TurboJpeg {
+class ScanlineDecoder;
+}
+
+// Outcome of splitting the source image for a single monitor
+struct MonitorSplitResult {
+    MonitorInfo monitor;
+    int index = -1;
+    QString outputPath;
+    bool success = false;
+    // Output carried over from the previous split because this monitor's
+    // part of the source did not change (incremental mode)
+    bool reused = false;
+};
+
+// One monitor's scaled image, produced in memory by splitToImages().
+// Move-only, so the pixels of a result have exactly one owner. The image
+// either owns its pixels or wraps a destination buffer the caller provided.
+class MonitorImage {
+public:
+    MonitorImage() = default;
+    MonitorImage(const MonitorPlan& plan, QImage image, bool pooled)
+        : m_plan(plan), m_image(std::move(image)), m_pooled(pooled) {}
+    
+    MonitorImage(MonitorImage&&) noexcept = default;
+    MonitorImage& operator=(MonitorImage&&) noexcept = default;
+    MonitorImage(const MonitorImage&) = delete;
+    MonitorImage& operator=(const MonitorImage&) = delete;
+    
+    const MonitorPlan& plan() const { return m_plan; }
+    const QImage& image() const { return m_image; }
+    bool isNull() const { return m_image.isNull(); }
+    
+    // Whether the pixels came from the splitter's buffer pool and can be
+    // given back with ImageSplitter::recycle()
+    bool isPooled() const { return m_pooled; }
+    
+    // Take the pixels out, leaving a null result
+    QImage takeImage() { m_pooled = false; return std::move(m_image); }
+
+private:
+    MonitorPlan m_plan;
+    QImage m_image;
+    bool m_pooled = false;
+};
+
+// Encoded output of one monitor, produced in memory by encodeSplit()
+struct EncodedMonitorImage {
+    MonitorPlan plan;
+    QByteArray data;    // Empty if this monitor failed
+};
+
 class ImageSplitter {
 public:
-    ImageSplitter() = default;
-    virtual ~ImageSplitter() = default;
+    ImageSplitter();
+    virtual ~ImageSplitter();
 
-    // Split image for multiple monitors
+    // Split image for multiple monitors. Outputs are written to outputDir
+    // as <key>_<index>.<ext>, keyed by source, layout and settings; a split
+    // that is already there is reused without decoding (see SplitCache).
     virtual bool splitImage(const QString& inputPath, 
                            const MonitorList& monitors,
                            const QString& outputDir);
     
+    // Split a file whose cache identity is sourceId instead of its path,
+    // size and modification time, e.g. a temporary copy of a piped source
+    // keyed by its contents. It takes the same decode paths as a file.
+    bool splitImage(const QString& inputPath,
+                    const QByteArray& sourceId,
+                    const MonitorList& monitors,
+                    const QString& outputDir);
+    
+    // Split an already decoded image for multiple monitors. The cache key
+    // is derived from the image's pixels.
+    virtual bool splitImage(const QImage& source,
+                           const MonitorList& monitors,
+                           const QString& outputDir);
+    
+    // Crop and scale every monitor's part of an already decoded image into
+    // memory, in split order, without encoding or writing anything. With
+    // destinations, monitor i is scaled straight into (*destinations)[i],
+    // e.g. an image wrapping the caller's own buffer; it must have the
+    // planned target size (see planFor()), be Format_RGB32 (or
+    // Format_ARGB32_Premultiplied for sources with alpha) and not be shared
+    // with another QImage handle, or writing to it would detach a copy.
+    // Otherwise the buffers come from bufferPool().
+    bool splitToImages(const QImage& source,
+                       const MonitorList& monitors,
+                       std::vector<MonitorImage>* images,
+                       std::vector<QImage>* destinations = nullptr);
+    
+    // Split a raw pixel buffer the caller owns, read in place without
+    // copying; otherwise like splitToImages(QImage)
+    bool splitToImages(const uchar* data,
+                       const QSize& size,
+                       qsizetype bytesPerLine,
+                       QImage::Format format,
+                       const MonitorList& monitors,
+                       std::vector<MonitorImage>* images,
+                       std::vector<QImage>* destinations = nullptr);
+    
+    // Give the buffer of a pooled result back for later splits
+    void recycle(MonitorImage&& image);
+    
+    // Split an already decoded image and encode every monitor's output in
+    // the configured format into memory, in index order, instead of writing
+    // files. Nothing is read from or written to the split cache.
+    bool encodeSplit(const QImage& source,
+                     const MonitorList& monitors,
+                     std::vector<EncodedMonitorImage>* outputs);
+    
     // Split image for specific monitor
     virtual bool splitImageForMonitor(const QString& inputPath,
                                      const MonitorInfo& monitor,
                                      const QString& outputPath,
                                      int monitorIndex);
     
+    // Split an already decoded image for specific monitor. Without the
+    // rest of the layout the whole image is fitted to this monitor.
+    virtual bool splitImageForMonitor(const QImage& source,
+                                     const MonitorInfo& monitor,
+                                     const QString& outputPath,
+                                     int monitorIndex);
+    
+    // Crop, scale and save one monitor's part of the image as planned
+    virtual bool splitImageForMonitor(const QImage& source,
+                                     const MonitorPlan& plan,
+                                     const QString& outputPath);
+    
     // Get optimal image size for monitor layout
     virtual QSize getOptimalImageSize(const MonitorList& monitors);
     
     // Validate if image can be split for given monitors
     virtual bool validateImage(const QString& imagePath, 
                               const MonitorList& monitors);
+    
+    // Validate an already decoded image for given monitors
+    virtual bool validateImage(const QImage& image,
+                              const MonitorList& monitors);
+    
+    // Decode an image file. QImage is implicitly shared, so the returned
+    // handle can be passed to every split step without copying pixels.
+    // JPEG files are decoded with libjpeg-turbo when the build has it.
+    static QImage loadImage(const QString& imagePath);
+    
+    // Decode an image file, letting the decoder downscale to scaledSize
+    static QImage loadImage(const QString& imagePath, const QSize& scaledSize);
+    
+    // Decode an image held in memory, e.g. read from a pipe
+    static QImage loadImageData(const QByteArray& data, const QSize& scaledSize = QSize());
+    
+    // Decode only a region of an image file. With a valid scaledSize the
+    // image is scaled to that size first and the region is in scaled
+    // coordinates, so the decoder can clip and scale in one pass.
+    static QImage loadImageRegion(const QString& imagePath,
+                                  const QRect& region,
+                                  const QSize& scaledSize = QSize());
+    
+    // Power-of-two factor (1, 2, 4 or 8) by which a source of this format
+    // and size can be downscaled while decoding without any output ending
+    // up smaller than its crop. 1 means a full-resolution decode is needed.
+    static int scaledDecodeFactor(const QByteArray& format,
+                                  const QSize& sourceSize,
+                                  const MonitorList& monitors);
+    
+    // Decode oversized sources at reduced resolution when the layout allows
+    void setScaledDecodeEnabled(bool enabled) { m_scaledDecodeEnabled = enabled; }
+    bool isScaledDecodeEnabled() const { return m_scaledDecodeEnabled; }
+    
+    // Let each parallel worker decode only its own monitor's region when the
+    // image format supports clipped decoding
+    void setRegionDecodeEnabled(bool enabled) { m_regionDecodeEnabled = enabled; }
+    bool isRegionDecodeEnabled() const { return m_regionDecodeEnabled; }
+    
+    // Cut monitors whose crop needs no scaling straight out of a JPEG source
+    // in the DCT domain (no decode, no generation loss) when the output
+    // format is JPEG and the crop starts on an MCU boundary. Needs
+    // libjpeg-turbo.
+    void setLosslessCropEnabled(bool enabled) { m_losslessCropEnabled = enabled; }
+    bool isLosslessCropEnabled() const { return m_losslessCropEnabled; }
+    
+    // Filter used to scale each monitor's crop to its resolution
+    void setResampleFilter(ResampleFilter filter) { m_resampleFilter = filter; }
+    ResampleFilter resampleFilter() const { return m_resampleFilter; }
+    
+    // File format split images are written in. The file name extension of
+    // every output follows the format.
+    void setOutputFormat(OutputFormat format) { m_outputFormat = format; }
+    OutputFormat outputFormat() const { return m_outputFormat; }
+    
+    // Encoder quality for JPEG and PNG outputs; -1 uses the format's default
+    void setOutputQuality(int quality) { m_outputQuality = qBound(-1, quality, 100); }
+    int outputQuality() const { return m_outputQuality; }
+    
+    // Subsampling, DCT and scan settings for JPEG outputs
+    void setJpegOptions(const JpegOptions& options) { m_jpegOptions = options; }
+    const JpegOptions& jpegOptions() const { return m_jpegOptions; }
+    
+    // Size limit of the split output cache in each output directory; least
+    // recently used splits beyond it are deleted. 0 disables eviction.
+    void setCacheLimit(qint64 bytes) { m_cacheLimit = qMax<qint64>(0, bytes); }
+    qint64 cacheLimit() const { return m_cacheLimit; }
+    
+    // A cached split that eviction leaves alone besides the one just
+    // written, e.g. the split on screen while another splitter prefetches
+    // into the same directory. Not copied by copySettingsFrom().
+    void setKeepKey(const QString& key) { m_keepKey = key; }
+    QString keepKey() const { return m_keepKey; }
+    
+    // Checked between monitors; once *flag is set the split stops and fails
+    // without leaving outputs in the cache. A decode already running is
+    // finished first. The flag must outlive every split. nullptr (the
+    // default) makes splits uncancellable. Not copied by copySettingsFrom().
+    void setCancelFlag(const std::atomic<bool>* flag) { m_cancelFlag = flag; }
+    
+    // Size limit of the decoded source cache (see DecodedImageCache) kept in
+    // decodedCacheDirectory(outputDir). While enabled, a source split for
+    // the second time is decoded in one piece and cached, and later splits
+    // of it map it instead of decoding it. 0 (the default) disables it.
+    void setDecodedCacheLimit(qint64 bytes) { m_decodedCacheLimit = qMax<qint64>(0, bytes); }
+    qint64 decodedCacheLimit() const { return m_decodedCacheLimit; }
+    static QString decodedCacheDirectory(const QString& outputDir);
+    
+    // Fingerprint every monitor's region of a file source and keep the
+    // fingerprints in a manifest under manifestDirectory(outputDir). When
+    // the file is saved again, monitors whose region is unchanged reuse
+    // their previous output and only the others are scaled and encoded.
+    // Sources are decoded in one piece while enabled; streamed and
+    // losslessly cropped sources are split in full.
+    void setIncrementalEnabled(bool enabled) { m_incrementalEnabled = enabled; }
+    bool isIncrementalEnabled() const { return m_incrementalEnabled; }
+    static QString manifestDirectory(const QString& outputDir);
+    
+    // Ceiling for decoded pixel data held at once while splitting a file.
+    // JPEG sources that would exceed it are streamed in scanline stripes;
+    // others have each monitor's region decoded separately if their
+    // format can clip, and are decoded whole otherwise.
+    // 0 disables the ceiling. Qt's own allocation limit still applies to
+    // sources decoded through Qt (see raiseQtAllocationLimit()).
+    static constexpr qint64 DefaultMemoryLimit = qint64(1024) << 20;
+    void setMemoryLimit(qint64 bytes);
+    qint64 memoryLimit() const { return m_memoryLimit; }
+    
+    // Raise Qt's allocation limit for decoded images (256 MB by default) to
+    // bytes, so sources that fit a memory limit that large still decode in
+    // one piece; 0 removes Qt's limit. It is never lowered. The limit is
+    // process-wide and guards every QImageReader, so this is for
+    // applications to opt into once at startup; splitters never change it.
+    static void raiseQtAllocationLimit(qint64 bytes);
+    
+    // Non-owning view of a region of image. No pixels are copied; the view
+    // is only valid while image is alive and unmodified.
+    static QImage cropView(const QImage& image, const QRect& rect);
+    
+    // Pool recycling scaled output buffers across splits
+    ImageBufferPool& bufferPool() { return m_bufferPool; }
+    
+    // Number of worker threads used to process monitors in parallel.
+    // 0 uses one thread per core, 1 processes monitors serially.
+    void setThreadCount(int threads);
+    int threadCount() const { return m_threadCount; }
+    
+    // Take over every output-affecting setting of another splitter (format,
+    // quality, filter, decode options and limits), so both produce the same
+    // cache keys. Thread count, caches and results are not copied.
+    void copySettingsFrom(const ImageSplitter& other);
+    
+    // Split plan for a source size and layout, served from the plan cache
+    std::shared_ptr<const SplitPlan> planFor(const QSize& sourceSize,
+                                             const MonitorList& monitors);
+    
+    // Per-monitor results of the most recent splitImage() call
+    const std::vector<MonitorSplitResult>& lastResults() const { return m_lastResults; }
+    
+    // Monitors of the most recent split with wallpaperPath set to their
+    // output, ready for WallpaperApplier::applyWallpapers()
+    MonitorList lastOutputMonitors() const;
+    
+    // Whether the most recent split was served from the output cache
+    bool lastSplitCached() const { return m_lastSplitCached; }
+    
+    // Split cache key of the most recent splitImage() call
+    QString lastCacheKey() const { return m_lastCacheKey; }
 
 protected:
     // Helper method to calculate crop rectangle for monitor
@@ -37,8 +311,127 @@ protected:
                            const MonitorInfo& monitor,
                            const MonitorList& allMonitors);
     
+    using MonitorTask = std::function<bool(const MonitorPlan& plan, const QString& outputPath)>;
+    
+    // Decode and split a file that is not in the output cache
+    bool splitFile(const QString& inputPath,
+                   const QByteArray& sourceId,
+                   QImageReader& reader,
+                   const QSize& sourceSize,
+                   const MonitorList& monitors,
+                   const QString& outputDir,
+                   const QString& key);
+    
+    // Split a decoded image into the outputs of key
+    bool splitSource(const QImage& source,
+                     const MonitorList& monitors,
+                     const QString& outputDir,
+                     const QString& key);
+    
+    // Split a decoded file source like splitSource(), but reuse the outputs
+    // of the previous split recorded in manifestPath for every monitor
+    // whose region fingerprint matches, then record this split there
+    bool splitSourceIncremental(const QImage& source,
+                                const MonitorList& monitors,
+                                const QString& outputDir,
+                                const QString& key,
+                                const QString& manifestPath);
+    
+    // Manifest of the incremental splits of a file for a layout and the
+    // current settings. Unlike the cache key it ignores the file's
+    // contents, so every saved version of the file maps to the same one.
+    QString manifestPath(const QString& inputPath, const QSize& sourceSize,
+                         const MonitorList& monitors, const QString& outputDir) const;
+    
+    // Reset lastResults() with the output path of every monitor in the plan
+    bool prepareResults(const SplitPlan& plan, const QString& outputDir, const QString& key);
+    
+    // Fill lastResults() from a cached split, if every output of key exists
+    bool loadCachedResults(SplitCache& cache, const QString& key,
+                           const QSize& sourceSize, const MonitorList& monitors);
+    
+    // Evict old splits after a successful split, or drop a partial one
+    bool finishSplit(SplitCache& cache, const QString& key, bool success);
+    
+    // Cache key of a source (see SplitCache::fileFingerprint) split for a
+    // layout with the current settings. The settings that pick a decode
+    // path are part of it, and streamed says whether the source is split in
+    // stripes (see streamsSource()), so outputs of another path are never
+    // served for this one.
+    QString cacheKey(const QByteArray& sourceId, const QSize& sourceSize,
+                     const MonitorList& monitors, bool streamed = false) const;
+    
+    // Whether splitting the file reader reads streams it in stripes under
+    // the memory limit instead of decoding it whole. Only JPEG sources have
+    // a sequential decoder to stream from.
+    bool streamsSource(QImageReader& reader, const QSize& sourceSize,
+                       const MonitorList& monitors) const;
+    
+    // Identity of a decoded image: SHA-1 of its size, format and pixels
+    static QByteArray imageFingerprint(const QImage& image);
+    
+    // Run task for every prepared result, in parallel when configured
+    bool runMonitorTasks(const SplitPlan& plan, const MonitorTask& task);
+    
+    // Run task for indices 0..count-1, in parallel when configured
+    void runParallel(int count, const std::function<void(int index)>& task);
+    
+    // Decode a source once, top to bottom, in stripes of whole rows that
+    // fit the memory limit next to the outputs, and scale every monitor's
+    // output rows from the stripes that cover them. The outputs, in plan
+    // order, match a full decode, except that QtSmooth scales bilinearly.
+    bool streamSource(TurboJpeg::ScanlineDecoder& decoder,
+                      const SplitPlan& plan,
+                      std::vector<QImage>* outputs);
+    
+    // Whether a monitor's crop can be cut losslessly from a JPEG whose MCU
+    // has the given size
+    bool canCropLosslessly(const MonitorPlan& plan, const QSize& mcuSize) const;
+    
+    // Scale an already cropped region to the monitor size and save it
+    virtual bool writeMonitorImage(const QImage& region,
+                                   const MonitorPlan& plan,
+                                   const QString& outputPath);
+    
+    // Scale with the configured resample filter
+    QImage scaleImage(const QImage& image, const QSize& size);
+    
+    // Scale a cropped region to its monitor's target size, into destination
+    // when one is given. Without one, a region that needs no scaling is
+    // returned as is (still borrowing the source's pixels) and scaled
+    // regions get a pooled buffer. Every split path renders through this.
+    QImage renderMonitor(const QImage& region, const MonitorPlan& plan, QImage* destination = nullptr);
+    
+    // Check that an image of this size covers the virtual desktop
+    bool validateImageSize(const QSize& imageSize, const MonitorList& monitors);
+    
     // Helper method to get monitor index for simple horizontal splitting
     int getMonitorIndex(const MonitorInfo& monitor);
+    
+    // Resolve the configured thread count to an actual worker count
+    int effectiveThreadCount(int taskCount) const;
+
+private:
+    int m_threadCount;
+    bool m_scaledDecodeEnabled;
+    bool m_regionDecodeEnabled;
+    bool m_losslessCropEnabled;
+    qint64 m_memoryLimit;
+    ResampleFilter m_resampleFilter;
+    OutputFormat m_outputFormat;
+    int m_outputQuality;
+    JpegOptions m_jpegOptions;
+    qint64 m_cacheLimit;
+    qint64 m_decodedCacheLimit;
+    bool m_incrementalEnabled;
+    bool m_lastSplitCached;
+    QString m_lastCacheKey;
+    QString m_keepKey;
+    const std::atomic<bool>* m_cancelFlag;
+    std::unique_ptr<QThreadPool> m_threadPool;
+    SplitPlanCache m_planCache;
+    ImageBufferPool m_bufferPool;
+    std::vector<MonitorSplitResult> m_lastResults;
 };
 
 } // namespace WallpaperCore 
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "monitor_info.h"
+#include <QByteArray>
+#include <QJsonObject>
+#include <QString>
+
+namespace WallpaperCore {
+
+// Monitor layouts stored as JSON, so splits can be made for a known rig on
+// a machine without a display. The file is a list of monitors:
+//
+//   [ { "name": "DP-1", "primary": true,
+//       "geometry": { "x": 0, "y": 0, "width": 2560, "height": 1440 },
+//       "resolution": { "width": 5120, "height": 2880 } }, ... ]
+//
+// "resolution" (the physical pixel size) defaults to the geometry size.
+class LayoutFile {
+public:
+    static QByteArray toJson(const MonitorList& monitors);
+    static QJsonObject monitorToJson(const MonitorInfo& monitor);
+    static bool fromJson(const QByteArray& json, MonitorList* monitors, QString* error = nullptr);
+
+    // Read or write a layout file; "-" is stdin or stdout
+    static bool load(const QString& path, MonitorList* monitors, QString* error = nullptr);
+    static bool save(const QString& path, const MonitorList& monitors, QString* error = nullptr);
+};
+
+} // namespace WallpaperCore
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "monitor_info.h"
+#include <QDateTime>
+#include <QList>
+#include <QString>
+#include <QVector>
+
+namespace WallpaperCore {
+
+// A monitor layout that has been seen before, e.g. "docked" or "laptop only"
+struct LayoutProfile {
+    QString key;
+    MonitorList monitors;      // In detection order
+    QVector<bool> enabled;     // Per monitor, as the user left it
+    QDateTime lastSeen;
+
+    // The monitors wallpapers are split for on this layout
+    MonitorList enabledMonitors() const;
+};
+
+// Remembers every monitor layout the application has run on, keyed by a
+// hash of the monitor geometries, so splits for layouts that are not
+// connected right now can be prepared ahead of a dock or undock.
+// Profiles are kept in an INI file; the least recently seen ones are
+// dropped beyond maxProfiles.
+class LayoutProfileStore {
+public:
+    static constexpr int DefaultMaxProfiles = 8;
+
+    explicit LayoutProfileStore(const QString& configPath, int maxProfiles = DefaultMaxProfiles);
+
+    // Identity of a layout: the geometries and resolutions of its monitors
+    // in position order. Connector names are left out, so the same desk
+    // is recognised whichever port a monitor is plugged into.
+    static QString layoutKey(const MonitorList& monitors);
+
+    bool contains(const QString& key) const;
+    LayoutProfile profile(const QString& key) const;
+
+    // All profiles, most recently seen first
+    QList<LayoutProfile> profiles() const;
+
+    // Record the current layout and its enabled monitors; returns its key
+    QString remember(const MonitorList& monitors, const QVector<bool>& enabled);
+
+    void remove(const QString& key);
+
+private:
+    void load();
+    void save() const;
+
+    QString m_configPath;
+    int m_maxProfiles;
+    QList<LayoutProfile> m_profiles;
+};
+
+} // namespace WallpaperCore
@@ -2,30 +2,56 @@
 
 #include "monitor_info.h"
 #include <QObject>
+#include <QTimer>
+
+class QScreen;
 
 namespace WallpaperCore {
 
+// Keeps a list of the connected monitors up to date from Qt's screen
+// notifications. Bursts of changes (a dock connecting several screens,
+// a resolution change moving the screens next to it) are collected and
+// reported as a single monitorsChanged().
 class MonitorDetector : public QObject {
     Q_OBJECT
 
 public:
+    // How long screen changes are collected before monitorsChanged()
+    static constexpr int DefaultSettleDelay = 250;
+
     explicit MonitorDetector(QObject* parent = nullptr);
     virtual ~MonitorDetector() = default;
 
-    // Detect all connected monitors
+    // Connected monitors. Returns the cached list, which screen events keep
+    // current, so this never blocks.
     virtual MonitorList detectMonitors();
     
     // Get the primary monitor
     virtual MonitorInfo getPrimaryMonitor();
     
-    // Refresh monitor list
+    // Re-read the screens now and emit monitorsChanged()
     virtual void refreshMonitors();
 
 signals:
     void monitorsChanged();
 
 protected:
+    // Build the monitor list from QGuiApplication::screens()
+    virtual MonitorList readScreens() const;
+
     MonitorList m_monitors;
+
+private:
+    void watchScreen(QScreen* screen);
+    void scheduleUpdate();
+    void updateMonitors();
+    
+    // Ask plasmashell how it maps desktops to screens, for the log only.
+    // Runs asynchronously and never delays detection.
+    void queryPlasmaScreens();
+
+    bool m_valid;
+    QTimer m_settleTimer;
 };
 
-} // namespace WallpaperCore 
\ No newline at end of file
+} // namespace WallpaperCore
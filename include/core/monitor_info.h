@@ -2,6 +2,7 @@
 
 #include <QString>
 #include <QRect>
+#include <algorithm>
 #include <vector>
 
 namespace WallpaperCore {
@@ -20,4 +21,19 @@ struct MonitorInfo {
 
 using MonitorList = std::vector<MonitorInfo>;
 
+// Sort monitors left to right, then top to bottom. The splitter and the
+// applier both use this order so output indices line up.
+inline MonitorList sortedByPosition(const MonitorList& monitors)
+{
+    MonitorList sorted = monitors;
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const MonitorInfo& a, const MonitorInfo& b) {
+                         if (a.geometry.x() != b.geometry.x()) {
+                             return a.geometry.x() < b.geometry.x();
+                         }
+                         return a.geometry.y() < b.geometry.y();
+                     });
+    return sorted;
+}
+
 } // namespace WallpaperCore 
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <QImage>
+#include <QSize>
+#include <QString>
+
+namespace WallpaperCore {
+
+// Filters used to scale each monitor's crop to its resolution. QtSmooth
+// uses QImage::scaled(); the others use the separable Resampler.
+enum class ResampleFilter {
+    QtSmooth,
+    Box,        // Area averaging
+    Bilinear,   // Triangle filter, stretched over the source footprint
+    Lanczos3
+};
+
+// Separable two-pass resampler for 32-bit pixels with SSE4.1 and AVX2
+// kernels picked at runtime and a portable scalar fallback. All kernels
+// produce bit-identical results. Filter coefficient tables are cached per
+// (source length, destination length, filter).
+class Resampler {
+public:
+    enum class Isa {
+        Auto,       // Best instruction set supported by this CPU
+        Scalar,
+        SSE41,
+        AVX2
+    };
+
+    // Best instruction set supported by this CPU and build
+    static Isa detectIsa();
+    static QString isaName(Isa isa);
+
+    // Scale an image with the given filter. Images with alpha are resampled
+    // as premultiplied ARGB32, everything else as RGB32.
+    static QImage scaled(const QImage& image, const QSize& size,
+                         ResampleFilter filter, Isa isa = Isa::Auto);
+
+    // Scale an image into a preallocated RGB32 or premultiplied ARGB32
+    // destination. The source may be a non-owning view into a larger image.
+    static bool scaleInto(const QImage& image, QImage& destination,
+                          ResampleFilter filter, Isa isa = Isa::Auto);
+
+    // Format scaled() produces for an image
+    static QImage::Format resampleFormat(const QImage& image);
+
+    // Resample raw 4-byte-per-pixel data with arbitrary strides. src and
+    // dst must not overlap. Returns false for QtSmooth or empty sizes.
+    // premultiplied marks premultiplied ARGB32 data, whose colour channels
+    // are then kept within alpha where the filter overshoots.
+    static bool resample(const uchar* src, int srcWidth, int srcHeight, qsizetype srcStride,
+                         uchar* dst, int dstWidth, int dstHeight, qsizetype dstStride,
+                         ResampleFilter filter, Isa isa = Isa::Auto, bool premultiplied = false);
+
+    // Output rows [dstBegin, dstEnd) of resampling srcWidth x srcHeight to
+    // dstWidth x dstHeight, reading only a stripe of the source: src holds
+    // source rows from srcTop on, at least those sourceRows() names. dst
+    // receives just the requested rows. Stripes stitched together equal one
+    // resample() of the whole image, so large images can be scaled without
+    // holding them whole.
+    static bool resampleRows(const uchar* src, int srcWidth, int srcHeight, int srcTop, qsizetype srcStride,
+                             uchar* dst, int dstWidth, int dstHeight, int dstBegin, int dstEnd,
+                             qsizetype dstStride, ResampleFilter filter, Isa isa = Isa::Auto,
+                             bool premultiplied = false);
+
+    // Source rows [*first, *last) that output rows [dstBegin, dstEnd) of a
+    // srcLength -> dstLength resample read, filter support included
+    static bool sourceRows(int srcLength, int dstLength, int dstBegin, int dstEnd,
+                           ResampleFilter filter, int* first, int* last);
+
+    // Filter names as used on the command line ("qt", "box", "bilinear", "lanczos3")
+    static QString filterName(ResampleFilter filter);
+    static bool parseFilter(const QString& name, ResampleFilter* filter);
+
+    static void clearCoefficientCache();
+};
+
+} // namespace WallpaperCore
\ No newline at end of file
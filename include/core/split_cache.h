@@ -0,0 +1,62 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+namespace WallpaperCore {
+
+// Content-addressed store of split outputs in an output directory. Each
+// split is written as <key>_<index>.<ext>, where the key hashes everything
+// that determines the pixels (source, layout, plan and encoder settings).
+// Re-splitting a known image is a lookup, and every distinct split gets
+// distinct file names, so the desktop always sees a path change.
+//
+// The cache keeps no state of its own: file modification times record
+// recency, and the least recently used splits are evicted once the
+// directory's cache files exceed the size limit.
+class SplitCache {
+public:
+    static constexpr qint64 DefaultMaxBytes = qint64(512) << 20;
+
+    explicit SplitCache(const QString& directory, qint64 maxBytes = DefaultMaxBytes);
+
+    // Identity of a source file that changes whenever the file does
+    // (canonical path, size and modification time)
+    static QByteArray fileFingerprint(const QString& path);
+
+    // Turn hashed split parameters into a cache key
+    static QString keyFor(const QByteArray& parameters);
+
+    // Whether a file name belongs to a cached split
+    static bool isCacheFileName(const QString& fileName);
+
+    QString directory() const { return m_directory; }
+    qint64 maxBytes() const { return m_maxBytes; }
+
+    // Path of output index of the split with this key
+    QString outputPath(const QString& key, int index, const QString& extension) const;
+
+    // Return the paths of all count outputs of a cached split and mark it as
+    // recently used. Returns an empty list if any output is missing.
+    QStringList lookup(const QString& key, int count, const QString& extension);
+
+    // Delete every output of a split, e.g. after a failed write
+    void remove(const QString& key);
+
+    // Delete least recently used splits until the cache fits its size
+    // limit. keepKeys (normally the split just written and the one on
+    // screen) are never evicted.
+    void evict(const QStringList& keepKeys = QStringList());
+
+    // Total size of all cached splits
+    qint64 totalBytes() const;
+
+    void clear();
+
+private:
+    QString m_directory;
+    qint64 m_maxBytes;
+};
+
+} // namespace WallpaperCore
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "monitor_info.h"
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QRect>
+#include <QSize>
+#include <memory>
+#include <vector>
+
+namespace WallpaperCore {
+
+// Geometry and resampling parameters for a single monitor's output
+struct MonitorPlan {
+    MonitorInfo monitor;
+    int index = -1;             // Output index (left to right, top to bottom)
+    QRect cropRect;             // Region of the source image, in source pixels
+    QSize targetSize;           // Size of the written wallpaper: the monitor's
+                                // actual resolution, else its geometry
+    double scaleX = 1.0;        // Source pixels per output pixel (horizontal)
+    double scaleY = 1.0;        // Source pixels per output pixel (vertical)
+    Qt::TransformationMode transformation = Qt::SmoothTransformation;
+
+    bool needsScaling() const { return cropRect.size() != targetSize; }
+};
+
+// Split geometry for one (source size, monitor layout) pair. The virtual
+// desktop is mapped onto the whole source image, so every monitor gets the
+// part of the image that matches its position in the layout.
+class SplitPlan {
+public:
+    SplitPlan() = default;
+
+    // Compute the plan for a source image of the given size
+    static SplitPlan create(const QSize& sourceSize, const MonitorList& monitors);
+
+    // Hash identifying a (source size, layout) pair; the layout covers
+    // every monitor's geometry and actual resolution
+    static QByteArray layoutKey(const QSize& sourceSize, const MonitorList& monitors);
+
+    // This plan describing the given monitors, which must have the layout
+    // key of the plan (same geometries and resolutions, e.g. renamed)
+    SplitPlan withMonitors(const MonitorList& monitors) const;
+
+    // Map a monitor geometry onto the source image. Adjacent monitors get
+    // adjacent crops without gaps or overlaps.
+    static QRect cropRectFor(const QSize& sourceSize,
+                             const QRect& geometry,
+                             const QRect& virtualDesktop);
+
+    bool isValid() const { return !m_monitors.empty(); }
+    const QByteArray& key() const { return m_key; }
+    QSize sourceSize() const { return m_sourceSize; }
+    QRect virtualDesktop() const { return m_virtualDesktop; }
+    const std::vector<MonitorPlan>& monitors() const { return m_monitors; }
+
+private:
+    QByteArray m_key;
+    QSize m_sourceSize;
+    QRect m_virtualDesktop;
+    std::vector<MonitorPlan> m_monitors;
+};
+
+// Thread-safe in-memory cache of split plans keyed by layout hash, so
+// repeated splits on a fixed layout skip all planning work. Plans are
+// returned with the caller's MonitorInfo (names, primary flags), not those
+// of the layout that first produced the key.
+class SplitPlanCache {
+public:
+    explicit SplitPlanCache(int capacity = 16);
+
+    // Return the cached plan for this pair, computing it on a miss
+    std::shared_ptr<const SplitPlan> plan(const QSize& sourceSize,
+                                          const MonitorList& monitors);
+
+    void clear();
+
+private:
+    QMutex m_mutex;
+    int m_capacity;
+    QHash<QByteArray, std::shared_ptr<const SplitPlan>> m_plans;
+    QList<QByteArray> m_recentKeys; // Most recently used last
+};
+
+} // namespace WallpaperCore
\ No newline at end of file
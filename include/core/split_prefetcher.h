@@ -0,0 +1,106 @@
+#pragma once
+
+#include "image_splitter.h"
+#include "monitor_info.h"
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <atomic>
+
+namespace WallpaperCore {
+
+// One image to split for one layout
+struct PrefetchJob {
+    QString imagePath;
+    MonitorList monitors;
+};
+
+// Splits upcoming images into the split cache on a low-priority background
+// thread, so that applying one of them later only has to look the split up.
+// Uses its own ImageSplitter configured like the foreground one, so both
+// produce the same cache keys.
+class SplitPrefetcher : public QObject {
+    Q_OBJECT
+
+public:
+    // Defaults: background splits hold at most 256 MB of decoded pixels and
+    // write at most 256 MB of outputs between two applied splits
+    static constexpr qint64 DefaultMemoryBudget = qint64(256) << 20;
+    static constexpr qint64 DefaultDiskBudget = qint64(256) << 20;
+
+    explicit SplitPrefetcher(QObject* parent = nullptr);
+    ~SplitPrefetcher() override;
+
+    // Copy output settings from the splitter that applies wallpapers
+    void setSplitterSettings(const ImageSplitter& splitter);
+
+    // Ceiling for decoded pixel data of a background split; larger sources
+    // are streamed (see ImageSplitter::setMemoryLimit). 0 = no extra ceiling.
+    void setMemoryBudget(qint64 bytes);
+    qint64 memoryBudget() const;
+
+    // Bytes of new outputs written before the rest of the queue is dropped,
+    // counted across prefetch() calls until setKeepKey() names a new split.
+    // 0 leaves it to the split cache's own limit.
+    void setDiskBudget(qint64 bytes);
+    qint64 diskBudget() const;
+
+    // Replace the queue with imagePaths, split in order for this layout.
+    // An image that is already being split is finished, not restarted.
+    void prefetch(const QStringList& imagePaths,
+                  const MonitorList& monitors,
+                  const QString& outputDir);
+
+    // Replace the queue with jobs that may target different layouts, e.g.
+    // the current image for every known monitor profile
+    void prefetch(const QList<PrefetchJob>& jobs, const QString& outputDir);
+
+    // Split cache key of the split on screen (see
+    // ImageSplitter::lastCacheKey()), which background splits never evict.
+    // A new key also restarts the disk budget.
+    void setKeepKey(const QString& key);
+
+    // Drop all queued images; a split in progress still completes
+    void cancel();
+
+    // Make sure imagePath is not being split in the background, so the
+    // caller can split it with all its threads. A background split of it is
+    // cancelled at the next monitor and this blocks until it has stopped.
+    // A queued job for the same image and layout is dropped; jobs for other
+    // layouts stay queued.
+    void waitFor(const QString& imagePath, const MonitorList& monitors);
+
+    bool isIdle() const;
+
+signals:
+    void imagePrefetched(const QString& imagePath, bool success, bool cached);
+    void finished();
+
+private:
+    void run();
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_currentDone;
+    QThreadPool m_pool;
+
+    // Settings holder; only read and written under m_mutex
+    ImageSplitter m_settings;
+    // Used by the worker thread only
+    ImageSplitter m_splitter;
+
+    QList<PrefetchJob> m_queue;
+    QString m_outputDir;
+    QString m_current;
+    QString m_keepKey;
+    std::atomic<bool> m_cancelCurrent;
+    bool m_running;
+    qint64 m_memoryBudget;
+    qint64 m_diskBudget;
+    qint64 m_bytesWritten;
+};
+
+} // namespace WallpaperCore
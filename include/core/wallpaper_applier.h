@@ -1,25 +1,88 @@
 #pragma once
 
 #include "monitor_info.h"
+#include <QByteArray>
+#include <QDBusPendingCall>
+#include <QHash>
 #include <QString>
+#include <QStringList>
 #include <QObject>
 
 namespace WallpaperCore {
 
+class WallpaperApplier;
+
+// Handle of an asynchronous wallpaper change. Owned by the applier and
+// deleted once finished() has been delivered, so don't keep the pointer
+// past that.
+class ApplyJob : public QObject {
+    Q_OBJECT
+
+public:
+    const MonitorList& monitors() const { return m_monitors; }
+    bool isFinished() const { return m_finished; }
+    bool succeeded() const { return m_success; }
+    QString errorString() const { return m_error; }
+    
+    // Output of the desktop's script, for logging
+    QString output() const { return m_output; }
+    
+    // Run a local event loop until the job is done and return whether it
+    // succeeded. For callers without an event loop of their own (the CLI).
+    bool waitForFinished();
+
+signals:
+    void finished(bool success);
+
+private:
+    friend class WallpaperApplier;
+    explicit ApplyJob(const MonitorList& monitors, QObject* parent);
+
+    MonitorList m_monitors;
+    bool m_finished;
+    bool m_success;
+    QString m_error;
+    QString m_output;
+    
+    // What the desktop shows once the job succeeds (see
+    // WallpaperApplier::m_appliedWallpapers); replacesAppliedState means
+    // the job reconfigured every desktop
+    QHash<QString, QByteArray> m_appliedState;
+    bool m_replacesAppliedState;
+};
+
 class WallpaperApplier : public QObject {
     Q_OBJECT
 
 public:
+    static constexpr int DefaultTimeout = 10000;
+
     explicit WallpaperApplier(QObject* parent = nullptr);
     virtual ~WallpaperApplier() = default;
 
-    // Apply wallpaper to specific monitor
+    // Apply wallpaper to specific monitor, blocking until it is done
     virtual bool applyWallpaper(const MonitorInfo& monitor, 
                                const QString& wallpaperPath);
     
-    // Apply wallpapers to all monitors
+    // Apply wallpapers to all monitors, blocking until they are done
     virtual bool applyWallpapers(const MonitorList& monitors);
     
+    // Start applying without blocking the caller's thread. The desktop is
+    // driven from the event loop; wallpaperApplied() or wallpaperFailed()
+    // is emitted per monitor and then the job's finished().
+    ApplyJob* applyWallpaperAsync(const MonitorInfo& monitor,
+                                  const QString& wallpaperPath);
+    ApplyJob* applyWallpapersAsync(const MonitorList& monitors);
+    
+    // Forget what was applied, so the next apply reconfigures every
+    // desktop. Needed when the wallpaper may have been changed elsewhere
+    // or desktops were remapped (e.g. after a monitor change).
+    void forgetAppliedWallpapers() { m_appliedWallpapers.clear(); }
+    
+    // How long the desktop may take to apply wallpapers, in milliseconds
+    void setTimeout(int msecs) { m_timeout = qMax(0, msecs); }
+    int timeout() const { return m_timeout; }
+    
     // Get current wallpaper for monitor
     virtual QString getCurrentWallpaper(const MonitorInfo& monitor);
     
@@ -32,6 +95,41 @@ public:
 signals:
     void wallpaperApplied(const MonitorInfo& monitor, const QString& path);
     void wallpaperFailed(const MonitorInfo& monitor, const QString& error);
+
+protected:
+    // Send a desktop script to plasmashell; the reply carries its output
+    virtual QDBusPendingCall runScript(const QString& script);
+
+private:
+    // Run program for a job, failing it when it doesn't exit cleanly in time
+    ApplyJob* startJob(const MonitorList& monitors, const QString& program,
+                       const QStringList& arguments);
+    
+    // Run a desktop script in plasmashell over DBus for a job
+    ApplyJob* startScriptJob(const MonitorList& monitors, const QString& script);
+    
+    // A job that completes without running anything, e.g. because nothing
+    // changed; reported from the event loop so the caller can connect first
+    ApplyJob* finishedJob(const MonitorList& monitors, bool success,
+                          const QString& error = QString());
+    
+    // What identifies the image at path for the unchanged check: the path
+    // of a split output, the fingerprint (see SplitCache::fileFingerprint)
+    // of any other file
+    static QByteArray wallpaperIdentity(const QString& path);
+    
+    // Key of a monitor's desktop; matches the key the scripts compute
+    static QString monitorKey(const MonitorInfo& monitor);
+    
+    // Record the outcome, emit the per-monitor signals and finished()
+    void finishJob(ApplyJob* job, bool success, const QString& error = QString());
+
+    int m_timeout;
+    
+    // Wallpaper each desktop was last set to by this applier, as monitor
+    // key -> wallpaperIdentity() of the image. The key "*" stands for one
+    // image on every desktop.
+    QHash<QString, QByteArray> m_appliedWallpapers;
 };
 
 } // namespace WallpaperCore 
\ No newline at end of file
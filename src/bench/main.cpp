@@ -0,0 +1,571 @@
+#include <QBuffer>
+#include <QCommandLineParser>
+#include <QCommandLineOption>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QImageWriter>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <numeric>
+#include <vector>
+#include "core/image_encoder.h"
+#include "core/image_splitter.h"
+#include "core/resampler.h"
+#include "core/split_cache.h"
+
+// Stage-level benchmark of the split pipeline. Synthetic sources of several
+// widths are written in every source format and split for a matrix of
+// layouts. Each repetition times the stages one after another on a single
+// thread (decode, crop, scale, encode), then a complete splitImage() into
+// an emptied output directory as "total". The total uses the splitter's
+// real path (worker threads, reduced-resolution and region decodes), so it
+// is usually less than the sum of the stages.
+
+namespace {
+
+// Makes the render step of splitImage() callable, so scaling is timed
+// exactly the way the file splitter does it (pooled buffers, SIMD kernels)
+class StageSplitter : public WallpaperCore::ImageSplitter {
+public:
+    using WallpaperCore::ImageSplitter::renderMonitor;
+};
+
+struct Layout {
+    QString name;
+    WallpaperCore::MonitorList monitors;
+};
+
+WallpaperCore::MonitorInfo makeMonitor(const QString& name, const QRect& geometry,
+                                       const QSize& resolution = QSize())
+{
+    WallpaperCore::MonitorInfo monitor;
+    monitor.name = name;
+    monitor.geometry = geometry;
+    monitor.actualResolution = resolution.isValid() ? resolution : geometry.size();
+    monitor.isPrimary = geometry.topLeft() == QPoint(0, 0);
+    return monitor;
+}
+
+// Rows x columns of identical monitors
+Layout gridLayout(int columns, int rows, const QSize& size)
+{
+    Layout layout{QString("%1x%2-%3p").arg(columns).arg(rows).arg(size.height()), {}};
+    for (int row = 0; row < rows; ++row) {
+        for (int column = 0; column < columns; ++column) {
+            QRect geometry(QPoint(column * size.width(), row * size.height()), size);
+            layout.monitors.push_back(makeMonitor(QString("M%1").arg(layout.monitors.size()), geometry));
+        }
+    }
+    return layout;
+}
+
+// 2 to 16 monitors: rows, grids, a vertical stack, and a row of mixed
+// sizes, offsets and pixel densities
+std::vector<Layout> layoutMatrix()
+{
+    std::vector<Layout> layouts;
+    layouts.push_back(gridLayout(2, 1, QSize(1920, 1080)));
+
+    Layout mixed{"3-mixed", {}};
+    mixed.monitors.push_back(makeMonitor("DP-1", QRect(0, 720, 2560, 1440)));
+    mixed.monitors.push_back(makeMonitor("DP-2", QRect(2560, 0, 3840, 2160)));
+    mixed.monitors.push_back(makeMonitor("HDMI-1", QRect(6400, 1080, 1920, 1080), QSize(3840, 2160)));
+    layouts.push_back(mixed);
+
+    Layout stack{"2-vertical-1440p", {}};
+    stack.monitors.push_back(makeMonitor("DP-1", QRect(0, 0, 2560, 1440)));
+    stack.monitors.push_back(makeMonitor("DP-2", QRect(0, 1440, 2560, 1440)));
+    layouts.push_back(stack);
+
+    layouts.push_back(gridLayout(2, 2, QSize(1920, 1080)));
+    layouts.push_back(gridLayout(4, 2, QSize(1920, 1080)));
+    layouts.push_back(gridLayout(4, 4, QSize(1920, 1080)));
+    return layouts;
+}
+
+// Smooth gradients with a little noise, so every encoder does realistic
+// work instead of compressing a flat image away
+QImage syntheticImage(const QSize& size)
+{
+    QImage image(size, QImage::Format_RGB32);
+    if (image.isNull()) {
+        return image;
+    }
+
+    quint32 state = 0x9e3779b9u;
+    const int width = size.width();
+    const int height = size.height();
+    for (int y = 0; y < height; ++y) {
+        QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        const int g = y * 255 / qMax(1, height - 1);
+        for (int x = 0; x < width; ++x) {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            const int noise = static_cast<int>(state & 15) - 8;
+            const int r = x * 255 / qMax(1, width - 1);
+            const int b = ((x ^ y) >> 4) & 0xff;
+            line[x] = qRgb(qBound(0, r + noise, 255), qBound(0, g + noise, 255),
+                           qBound(0, b + noise, 255));
+        }
+    }
+    return image;
+}
+
+// Write a source file in one of the benchmarked formats. JPEG and PNG use
+// the splitter's own encoder, WebP goes through Qt's image plugin.
+bool writeSource(const QImage& image, const QString& format, const QString& path)
+{
+    if (format == "jpeg") {
+        return WallpaperCore::ImageEncoder::save(image, path, WallpaperCore::OutputFormat::Jpeg, 90);
+    }
+    if (format == "png") {
+        return WallpaperCore::ImageEncoder::save(image, path, WallpaperCore::OutputFormat::Png);
+    }
+
+    QImageWriter writer(path, format.toLatin1());
+    writer.setQuality(90);
+    return writer.write(image);
+}
+
+struct StageSummary {
+    double medianMs = 0;
+    double minMs = 0;
+    double meanMs = 0;
+};
+
+StageSummary summarize(std::vector<qint64> samples)
+{
+    StageSummary summary;
+    if (samples.empty()) {
+        return summary;
+    }
+    std::sort(samples.begin(), samples.end());
+    summary.medianMs = samples[samples.size() / 2] / 1e6;
+    summary.minMs = samples.front() / 1e6;
+    summary.meanMs = std::accumulate(samples.begin(), samples.end(), qint64(0)) / 1e6 / samples.size();
+    return summary;
+}
+
+const char* const StageNames[] = {"decode", "crop", "scale", "encode", "total"};
+
+struct BenchResult {
+    QString sourceFormat;
+    QSize sourceSize;
+    qint64 sourceBytes = 0;
+    QString layout;
+    int monitors = 0;
+    QString status = "ok";
+    QString note;
+    std::map<QString, std::vector<qint64>> samples;
+};
+
+QStringList splitList(const QString& value)
+{
+    QStringList items;
+    for (const QString& item : value.split(',', Qt::SkipEmptyParts)) {
+        items << item.trimmed();
+    }
+    return items;
+}
+
+QByteArray toJson(const std::vector<BenchResult>& results, const QJsonObject& config)
+{
+    QJsonArray array;
+    for (const auto& result : results) {
+        QJsonObject source;
+        source.insert("format", result.sourceFormat);
+        source.insert("width", result.sourceSize.width());
+        source.insert("height", result.sourceSize.height());
+        source.insert("bytes", result.sourceBytes);
+
+        QJsonObject object;
+        object.insert("source", source);
+        object.insert("layout", result.layout);
+        object.insert("monitors", result.monitors);
+        object.insert("status", result.status);
+        if (!result.note.isEmpty()) {
+            object.insert("note", result.note);
+        }
+
+        QJsonObject stages;
+        for (const char* stage : StageNames) {
+            auto it = result.samples.find(stage);
+            if (it == result.samples.end()) {
+                continue;
+            }
+            StageSummary summary = summarize(it->second);
+            QJsonObject timing;
+            timing.insert("median_ms", summary.medianMs);
+            timing.insert("min_ms", summary.minMs);
+            timing.insert("mean_ms", summary.meanMs);
+            stages.insert(stage, timing);
+        }
+        if (!stages.isEmpty()) {
+            object.insert("stages", stages);
+        }
+        array.append(object);
+    }
+
+    QJsonObject document;
+    document.insert("config", config);
+    document.insert("results", array);
+    return QJsonDocument(document).toJson(QJsonDocument::Indented);
+}
+
+QByteArray toCsv(const std::vector<BenchResult>& results)
+{
+    QByteArray csv;
+    QTextStream stream(&csv);
+    stream << "source_format,source_width,source_height,source_bytes,layout,monitors,status,stage,median_ms,min_ms,mean_ms\n";
+    for (const auto& result : results) {
+        QString prefix = QString("%1,%2,%3,%4,%5,%6,%7")
+            .arg(result.sourceFormat)
+            .arg(result.sourceSize.width())
+            .arg(result.sourceSize.height())
+            .arg(result.sourceBytes)
+            .arg(result.layout)
+            .arg(result.monitors)
+            .arg(result.status);
+        if (result.samples.empty()) {
+            stream << prefix << ",,,,\n";
+            continue;
+        }
+        for (const char* stage : StageNames) {
+            auto it = result.samples.find(stage);
+            if (it == result.samples.end()) {
+                continue;
+            }
+            StageSummary summary = summarize(it->second);
+            stream << prefix << ',' << stage << ','
+                   << QString::number(summary.medianMs, 'f', 3) << ','
+                   << QString::number(summary.minMs, 'f', 3) << ','
+                   << QString::number(summary.meanMs, 'f', 3) << '\n';
+        }
+    }
+    stream.flush();
+    return csv;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("wallpaper-bench");
+    app.setApplicationVersion("1.0.0");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmark the stages of the wallpaper split pipeline");
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    QCommandLineOption widthsOption(QStringList() << "widths",
+        "Comma-separated widths of the synthetic sources", "pixels", "3840,7680,15360,30720");
+    parser.addOption(widthsOption);
+
+    QCommandLineOption aspectOption(QStringList() << "aspect",
+        "Aspect ratio of the synthetic sources", "w:h", "32:9");
+    parser.addOption(aspectOption);
+
+    QCommandLineOption sourceFormatsOption(QStringList() << "source-formats",
+        "Comma-separated source file formats", "formats", "jpeg,png,webp");
+    parser.addOption(sourceFormatsOption);
+
+    QCommandLineOption layoutsOption(QStringList() << "layouts",
+        "Comma-separated layout names to run (default: all; see --list-layouts)", "names");
+    parser.addOption(layoutsOption);
+
+    QCommandLineOption listLayoutsOption(QStringList() << "list-layouts",
+        "List the layout matrix and exit");
+    parser.addOption(listLayoutsOption);
+
+    QCommandLineOption warmupOption(QStringList() << "warmup",
+        "Untimed repetitions before measuring", "count", "1");
+    parser.addOption(warmupOption);
+
+    QCommandLineOption repetitionsOption(QStringList() << "r" << "repetitions",
+        "Timed repetitions per source and layout", "count", "5");
+    parser.addOption(repetitionsOption);
+
+    QCommandLineOption reportOption(QStringList() << "report",
+        "Report format: json or csv", "format", "json");
+    parser.addOption(reportOption);
+
+    QCommandLineOption outputOption(QStringList() << "o" << "output",
+        "Write the report to a file instead of stdout", "file");
+    parser.addOption(outputOption);
+
+    QCommandLineOption formatOption(QStringList() << "f" << "format",
+        "Output format of the split images", "format",
+        WallpaperCore::ImageEncoder::formatName(WallpaperCore::OutputFormat::Jpeg));
+    parser.addOption(formatOption);
+
+    QCommandLineOption qualityOption(QStringList() << "quality",
+        "Encoder quality of the split images (-1 = format default)", "quality", "-1");
+    parser.addOption(qualityOption);
+
+    QCommandLineOption fastDctOption(QStringList() << "fast-dct",
+        "Encode JPEG outputs with the fast integer DCT (libjpeg-turbo builds only)");
+    parser.addOption(fastDctOption);
+
+    QCommandLineOption filterOption(QStringList() << "filter",
+        "Resampling filter: qt, box, bilinear or lanczos3", "filter",
+        WallpaperCore::Resampler::filterName(WallpaperCore::ResampleFilter::Bilinear));
+    parser.addOption(filterOption);
+
+    QCommandLineOption jobsOption(QStringList() << "j" << "jobs",
+        "Worker threads of the total stage (0 = one per CPU core)", "threads", "0");
+    parser.addOption(jobsOption);
+
+    parser.process(app);
+
+    // The largest sources are far above Qt's default decode limit
+    QImageReader::setAllocationLimit(0);
+
+    std::vector<Layout> layouts = layoutMatrix();
+    if (parser.isSet(listLayoutsOption)) {
+        for (const auto& layout : layouts) {
+            QRect desktop;
+            for (const auto& monitor : layout.monitors) {
+                desktop = desktop.united(monitor.geometry);
+            }
+            qInfo().noquote() << QString("%1  %2 monitor(s), %3x%4 desktop")
+                .arg(layout.name, -18).arg(layout.monitors.size())
+                .arg(desktop.width()).arg(desktop.height());
+        }
+        return 0;
+    }
+
+    if (parser.isSet(layoutsOption)) {
+        QStringList names = splitList(parser.value(layoutsOption));
+        layouts.erase(std::remove_if(layouts.begin(), layouts.end(), [&names](const Layout& layout) {
+                          return !names.contains(layout.name);
+                      }),
+                      layouts.end());
+        if (layouts.empty()) {
+            qCritical() << "Error: No layout matches" << parser.value(layoutsOption);
+            return 1;
+        }
+    }
+
+    std::vector<int> widths;
+    for (const QString& item : splitList(parser.value(widthsOption))) {
+        bool ok = false;
+        int width = item.toInt(&ok);
+        if (!ok || width <= 0) {
+            qCritical() << "Error: Invalid width:" << item;
+            return 1;
+        }
+        widths.push_back(width);
+    }
+
+    QStringList aspect = parser.value(aspectOption).split(':');
+    int aspectWidth = aspect.size() == 2 ? aspect[0].toInt() : 0;
+    int aspectHeight = aspect.size() == 2 ? aspect[1].toInt() : 0;
+    if (aspectWidth <= 0 || aspectHeight <= 0) {
+        qCritical() << "Error: Invalid aspect ratio:" << parser.value(aspectOption);
+        return 1;
+    }
+
+    bool warmupOk = false;
+    bool repetitionsOk = false;
+    int warmup = parser.value(warmupOption).toInt(&warmupOk);
+    int repetitions = parser.value(repetitionsOption).toInt(&repetitionsOk);
+    if (!warmupOk || warmup < 0 || !repetitionsOk || repetitions < 1) {
+        qCritical() << "Error: Invalid --warmup or --repetitions";
+        return 1;
+    }
+
+    QString report = parser.value(reportOption);
+    if (report != "json" && report != "csv") {
+        qCritical() << "Error: Unknown report format:" << report;
+        return 1;
+    }
+
+    WallpaperCore::OutputFormat format;
+    if (!WallpaperCore::ImageEncoder::parseFormat(parser.value(formatOption), &format)) {
+        qCritical() << "Error: Unknown output format:" << parser.value(formatOption);
+        return 1;
+    }
+    WallpaperCore::ResampleFilter filter;
+    if (!WallpaperCore::Resampler::parseFilter(parser.value(filterOption), &filter)) {
+        qCritical() << "Error: Unknown resampling filter:" << parser.value(filterOption);
+        return 1;
+    }
+    int quality = qBound(-1, parser.value(qualityOption).toInt(), 100);
+    int jobs = qMax(0, parser.value(jobsOption).toInt());
+    WallpaperCore::JpegOptions jpegOptions;
+    jpegOptions.fastDct = parser.isSet(fastDctOption);
+
+    // The stages run on one thread through a splitter of their own; the
+    // total runs the real pipeline with its worker threads. Neither keeps a
+    // size limit on its outputs, which are deleted before every total.
+    StageSplitter stages;
+    stages.setThreadCount(1);
+    stages.setMemoryLimit(0);
+    stages.setResampleFilter(filter);
+    stages.setOutputFormat(format);
+    stages.setOutputQuality(quality);
+    stages.setJpegOptions(jpegOptions);
+
+    WallpaperCore::ImageSplitter pipeline;
+    pipeline.copySettingsFrom(stages);
+    pipeline.setMemoryLimit(WallpaperCore::ImageSplitter::DefaultMemoryLimit);
+    pipeline.setCacheLimit(0);
+    pipeline.setThreadCount(jobs);
+
+    QTemporaryDir workDir;
+    if (!workDir.isValid()) {
+        qCritical() << "Error: Cannot create a temporary directory";
+        return 1;
+    }
+    QString outputDir = workDir.filePath("outputs");
+    WallpaperCore::SplitCache outputs(outputDir, 0);
+
+    std::vector<BenchResult> results;
+    for (int width : widths) {
+        QSize sourceSize(width, qMax(1, int(qint64(width) * aspectHeight / aspectWidth)));
+        qInfo() << "Generating" << sourceSize << "source";
+        QImage image = syntheticImage(sourceSize);
+        if (image.isNull()) {
+            qWarning() << "Cannot allocate a" << sourceSize << "source; skipping";
+            continue;
+        }
+
+        for (const QString& sourceFormat : splitList(parser.value(sourceFormatsOption))) {
+            QString path = workDir.filePath(QString("source_%1.%2").arg(width).arg(sourceFormat == "jpeg" ? "jpg" : sourceFormat));
+            bool written = writeSource(image, sourceFormat, path);
+            qint64 sourceBytes = QFileInfo(path).size();
+
+            for (const auto& layout : layouts) {
+                BenchResult result;
+                result.sourceFormat = sourceFormat;
+                result.sourceSize = sourceSize;
+                result.sourceBytes = sourceBytes;
+                result.layout = layout.name;
+                result.monitors = static_cast<int>(layout.monitors.size());
+
+                QSize desktop = stages.getOptimalImageSize(layout.monitors);
+                if (!written) {
+                    result.status = "skipped";
+                    result.note = "cannot write this source format at this size";
+                } else if (sourceSize.width() < desktop.width() || sourceSize.height() < desktop.height()) {
+                    result.status = "skipped";
+                    result.note = "source is smaller than the layout";
+                }
+                if (result.status != "ok") {
+                    results.push_back(result);
+                    continue;
+                }
+
+                qInfo().noquote() << QString("Running %1 %2x%3 on %4")
+                    .arg(sourceFormat).arg(sourceSize.width()).arg(sourceSize.height()).arg(layout.name);
+
+                for (int round = 0; round < warmup + repetitions; ++round) {
+                    QElapsedTimer timer;
+
+                    timer.start();
+                    QImage source = WallpaperCore::ImageSplitter::loadImage(path);
+                    qint64 decodeNs = timer.nsecsElapsed();
+                    if (source.isNull()) {
+                        result.status = "failed";
+                        result.note = "decode failed";
+                        break;
+                    }
+
+                    timer.restart();
+                    std::shared_ptr<const WallpaperCore::SplitPlan> plan = stages.planFor(source.size(), layout.monitors);
+                    std::vector<QImage> regions;
+                    for (const auto& monitorPlan : plan->monitors()) {
+                        regions.push_back(WallpaperCore::ImageSplitter::cropView(source, monitorPlan.cropRect));
+                    }
+                    qint64 cropNs = timer.nsecsElapsed();
+
+                    timer.restart();
+                    std::vector<QImage> scaled;
+                    for (size_t i = 0; i < regions.size(); ++i) {
+                        scaled.push_back(stages.renderMonitor(regions[i], plan->monitors()[i]));
+                    }
+                    qint64 scaleNs = timer.nsecsElapsed();
+
+                    timer.restart();
+                    bool encoded = true;
+                    for (const QImage& output : scaled) {
+                        QBuffer buffer;
+                        buffer.open(QIODevice::WriteOnly);
+                        encoded = encoded && WallpaperCore::ImageEncoder::write(output, &buffer, format, quality,
+                                                                                jpegOptions);
+                    }
+                    qint64 encodeNs = timer.nsecsElapsed();
+
+                    for (size_t i = 0; i < scaled.size(); ++i) {
+                        if (plan->monitors()[i].needsScaling()) {
+                            stages.bufferPool().release(std::move(scaled[i]));
+                        }
+                    }
+                    scaled.clear();
+                    regions.clear();
+                    source = QImage();
+
+                    outputs.clear();
+                    timer.restart();
+                    bool split = pipeline.splitImage(path, layout.monitors, outputDir);
+                    qint64 totalNs = timer.nsecsElapsed();
+
+                    if (!encoded || !split) {
+                        result.status = "failed";
+                        result.note = encoded ? "split failed" : "encode failed";
+                        break;
+                    }
+
+                    if (round >= warmup) {
+                        result.samples["decode"].push_back(decodeNs);
+                        result.samples["crop"].push_back(cropNs);
+                        result.samples["scale"].push_back(scaleNs);
+                        result.samples["encode"].push_back(encodeNs);
+                        result.samples["total"].push_back(totalNs);
+                    }
+                }
+
+                if (result.status != "ok") {
+                    result.samples.clear();
+                }
+                results.push_back(result);
+            }
+            QFile::remove(path);
+        }
+    }
+    outputs.clear();
+
+    QJsonObject config;
+    config.insert("outputFormat", WallpaperCore::ImageEncoder::formatName(format));
+    config.insert("quality", quality);
+    config.insert("fastDct", jpegOptions.fastDct);
+    config.insert("filter", WallpaperCore::Resampler::filterName(filter));
+    config.insert("jobs", jobs);
+    config.insert("warmup", warmup);
+    config.insert("repetitions", repetitions);
+    config.insert("isa", WallpaperCore::Resampler::isaName(WallpaperCore::Resampler::detectIsa()));
+    config.insert("turbojpeg", WallpaperCore::ImageEncoder::hasTurboJpeg());
+
+    QByteArray data = report == "csv" ? toCsv(results) : toJson(results, config);
+    QFile output(parser.value(outputOption));
+    bool opened = parser.isSet(outputOption) ? output.open(QIODevice::WriteOnly)
+                                             : output.open(stdout, QIODevice::WriteOnly);
+    if (!opened || output.write(data) != data.size()) {
+        qCritical() << "Error: Cannot write the report:" << output.errorString();
+        return 1;
+    }
+    return 0;
+}
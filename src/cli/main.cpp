@@ -3,17 +3,80 @@
 #include <QCommandLineOption>
 #include <QDebug>
 #include <QDir>
+#include <QBuffer>
+#include <QCryptographicHash>
 #include <QCoreApplication>
+#include <QDataStream>
+#include <QDBusPendingCall>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QImageReader>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTemporaryFile>
+#include <QTimer>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "core/batch_splitter.h"
+#include "core/layout_file.h"
 #include "core/monitor_detector.h"
+#include "core/plasma_shell.h"
+#include "core/image_encoder.h"
 #include "core/image_splitter.h"
+#include "core/resampler.h"
 #include "core/wallpaper_applier.h"
 
+// Whether the monitors come from a layout file. Such runs need no display
+// connection, so they use a plain QCoreApplication.
+static bool usesLayoutFile(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        QByteArray argument(argv[i]);
+        if (argument == "--layout" || argument.startsWith("--layout=")) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// One monitor of a --stream output: the length of a JSON header (4 bytes,
+// big-endian), the header, the length of the encoded image (8 bytes,
+// big-endian) and the image
+static bool writeFrame(QIODevice* device, const WallpaperCore::MonitorPlan& plan,
+                       const QByteArray& data, WallpaperCore::OutputFormat format)
+{
+    QJsonObject header = WallpaperCore::LayoutFile::monitorToJson(plan.monitor);
+    header.insert("index", plan.index);
+    header.insert("format", WallpaperCore::ImageEncoder::formatName(format));
+    header.insert("width", plan.targetSize.width());
+    header.insert("height", plan.targetSize.height());
+    QByteArray json = QJsonDocument(header).toJson(QJsonDocument::Compact);
+    
+    QByteArray frame;
+    QDataStream stream(&frame, QIODevice::WriteOnly);
+    stream << quint32(json.size());
+    stream.writeRawData(json.constData(), json.size());
+    stream << quint64(data.size());
+    
+    return device->write(frame) == frame.size() &&
+           device->write(data) == data.size();
+}
+
 int main(int argc, char *argv[])
 {
-    QGuiApplication app(argc, argv);
-    app.setApplicationName("wallpaper-splitter-cli");
-    app.setApplicationVersion("1.0.0");
+    QElapsedTimer processTimer;
+    processTimer.start();
+    
+    std::unique_ptr<QCoreApplication> app(usesLayoutFile(argc, argv)
+                                          ? new QCoreApplication(argc, argv)
+                                          : new QGuiApplication(argc, argv));
+    app->setApplicationName("wallpaper-splitter-cli");
+    app->setApplicationVersion("1.0.0");
     
     QCommandLineParser parser;
     parser.setApplicationDescription("Split wallpapers for multi-monitor setups");
@@ -21,13 +84,30 @@ int main(int argc, char *argv[])
     parser.addVersionOption();
     
     QCommandLineOption imageOption(QStringList() << "i" << "image",
-        "Input image file to split", "file");
+        "Input image file to split (- reads it from stdin into a temporary file, so it is decoded like any other file)", "file");
     parser.addOption(imageOption);
     
+    QCommandLineOption batchOption(QStringList() << "batch",
+        "Split every image in a directory, or listed one path per line in a file, in a single run; inputs that are already split are skipped", "dir|list");
+    parser.addOption(batchOption);
+    
+    QCommandLineOption batchDecodedOption(QStringList() << "batch-decoded",
+        "Maximum number of decoded source images held at once during --batch", "images",
+        QString::number(WallpaperCore::BatchSplitter::DefaultMaxDecodedImages));
+    parser.addOption(batchDecodedOption);
+    
     QCommandLineOption outputOption(QStringList() << "o" << "output",
         "Output directory for split images", "directory");
     parser.addOption(outputOption);
     
+    QCommandLineOption streamOption(QStringList() << "stream",
+        "Write the split images to stdout as a stream of frames (JSON header with the monitor's geometry, then the encoded image) instead of files");
+    parser.addOption(streamOption);
+    
+    QCommandLineOption outputFdsOption(QStringList() << "output-fds",
+        "Write each monitor's image to one of these comma-separated file descriptors, in split order, instead of files", "fds");
+    parser.addOption(outputFdsOption);
+    
     QCommandLineOption applyOption(QStringList() << "a" << "apply",
         "Apply wallpapers after splitting");
     parser.addOption(applyOption);
@@ -36,16 +116,135 @@ int main(int argc, char *argv[])
         "List detected monitors");
     parser.addOption(listOption);
     
-    parser.process(app);
+    QCommandLineOption layoutOption(QStringList() << "layout",
+        "Use the monitors of a JSON layout file (see --dump-layout) instead of the connected screens; runs without a display", "file");
+    parser.addOption(layoutOption);
+    
+    QCommandLineOption dumpLayoutOption(QStringList() << "dump-layout",
+        "Write the monitor layout as JSON to a file (- for stdout) and exit", "file");
+    parser.addOption(dumpLayoutOption);
+    
+    QCommandLineOption timingsOption(QStringList() << "timings",
+        "Print how long startup, layout detection, splitting and applying took");
+    parser.addOption(timingsOption);
+    
+    QCommandLineOption jobsOption(QStringList() << "j" << "jobs",
+        "Number of monitors to process in parallel (0 = one per CPU core, 1 = serial)", "threads", "0");
+    parser.addOption(jobsOption);
+    
+    QCommandLineOption fullDecodeOption(QStringList() << "full-decode",
+        "Always decode the source at full resolution (disables reduced-resolution JPEG decoding)");
+    parser.addOption(fullDecodeOption);
+    
+    QCommandLineOption noRegionDecodeOption(QStringList() << "no-region-decode",
+        "Decode the whole source once instead of letting each worker decode only its monitor's region");
+    parser.addOption(noRegionDecodeOption);
+    
+    QCommandLineOption noLosslessCropOption(QStringList() << "no-lossless-crop",
+        "Always decode and re-encode, even where a JPEG crop could be cut out losslessly");
+    parser.addOption(noLosslessCropOption);
+    
+    QCommandLineOption filterOption(QStringList() << "filter",
+        "Resampling filter: qt, box, bilinear or lanczos3", "filter",
+        WallpaperCore::Resampler::filterName(WallpaperCore::ResampleFilter::Bilinear));
+    parser.addOption(filterOption);
+    
+    QCommandLineOption memoryLimitOption(QStringList() << "memory-limit",
+        "Maximum decoded image memory in MB; larger sources are split in stripes (0 = unlimited, Qt's image allocation limit included)", "MB",
+        QString::number(WallpaperCore::ImageSplitter::DefaultMemoryLimit >> 20));
+    parser.addOption(memoryLimitOption);
+    
+    QCommandLineOption cacheLimitOption(QStringList() << "cache-limit",
+        "Maximum size of cached split images in the output directory in MB; least recently used splits are deleted (0 = unlimited)", "MB",
+        QString::number(WallpaperCore::SplitCache::DefaultMaxBytes >> 20));
+    parser.addOption(cacheLimitOption);
+    
+    QCommandLineOption decodedCacheOption(QStringList() << "decoded-cache",
+        "Keep decoded sources as memory-mapped files of up to this many MB in total under <output>/decoded, so re-splitting a source skips the decode (0 = off)", "MB",
+        "0");
+    parser.addOption(decodedCacheOption);
+    
+    QCommandLineOption formatOption(QStringList() << "f" << "format",
+        "Output format: jpeg, png, bmp, ppm or qoi (bmp, ppm and qoi encode fastest)", "format",
+        WallpaperCore::ImageEncoder::formatName(WallpaperCore::OutputFormat::Jpeg));
+    parser.addOption(formatOption);
+    
+    QCommandLineOption qualityOption(QStringList() << "quality",
+        "JPEG/PNG encoder quality 0-100 (-1 = format default: 95 for JPEG, 80 for PNG)", "quality", "-1");
+    parser.addOption(qualityOption);
+    
+    QCommandLineOption subsamplingOption(QStringList() << "jpeg-subsampling",
+        "JPEG chroma subsampling: 444, 422 or 420 (libjpeg-turbo builds only)", "mode",
+        WallpaperCore::ImageEncoder::subsamplingName(WallpaperCore::JpegOptions().subsampling));
+    parser.addOption(subsamplingOption);
+    
+    QCommandLineOption fastDctOption(QStringList() << "fast-dct",
+        "Use the fast integer instead of the accurate DCT for JPEG output, trading some quality for encode time (libjpeg-turbo builds only)");
+    parser.addOption(fastDctOption);
+    
+    QCommandLineOption progressiveOption(QStringList() << "progressive",
+        "Write progressive instead of baseline JPEG output");
+    parser.addOption(progressiveOption);
+    
+    QCommandLineOption incrementalOption(QStringList() << "incremental",
+        "Only re-encode monitors whose part of the image changed since the last split of this file");
+    parser.addOption(incrementalOption);
+    
+    QCommandLineOption watchOption(QStringList() << "watch",
+        "Keep running and split again (incrementally) whenever the input image is saved");
+    parser.addOption(watchOption);
+    
+    QCommandLineOption compareDbusOption(QStringList() << "compare-dbus",
+        "Measure the latency of running a no-op Plasma script over the native DBus connection and through the qdbus tool");
+    parser.addOption(compareDbusOption);
+    
+    QCommandLineOption compareFormatsOption(QStringList() << "compare-formats",
+        "Benchmark encode time and file size of every output format for the input image, without writing files");
+    parser.addOption(compareFormatsOption);
+    
+    parser.process(*app);
+    qint64 startupNs = processTimer.nsecsElapsed();
     
     // Initialize core components
     WallpaperCore::MonitorDetector detector;
     WallpaperCore::ImageSplitter splitter;
     WallpaperCore::WallpaperApplier applier;
     
+    // Monitors come from the layout file when one is given, otherwise from
+    // the connected screens
+    auto loadMonitors = [&](WallpaperCore::MonitorList* monitors) -> bool {
+        if (!parser.isSet(layoutOption)) {
+            *monitors = detector.detectMonitors();
+            return true;
+        }
+        QString error;
+        if (!WallpaperCore::LayoutFile::load(parser.value(layoutOption), monitors, &error)) {
+            qCritical() << "Error: Cannot load layout:" << error;
+            return false;
+        }
+        return true;
+    };
+    
+    // Save the layout, e.g. to split for this rig on another machine
+    if (parser.isSet(dumpLayoutOption)) {
+        WallpaperCore::MonitorList monitors;
+        if (!loadMonitors(&monitors)) {
+            return 1;
+        }
+        QString error;
+        if (!WallpaperCore::LayoutFile::save(parser.value(dumpLayoutOption), monitors, &error)) {
+            qCritical() << "Error:" << error;
+            return 1;
+        }
+        return 0;
+    }
+    
     // List monitors if requested
     if (parser.isSet(listOption)) {
-        WallpaperCore::MonitorList monitors = detector.detectMonitors();
+        WallpaperCore::MonitorList monitors;
+        if (!loadMonitors(&monitors)) {
+            return 1;
+        }
         qInfo() << "Detected monitors:";
         for (const auto& monitor : monitors) {
             qInfo() << "  " << monitor.name 
@@ -56,8 +255,60 @@ int main(int argc, char *argv[])
         return 0;
     }
     
+    // Time the same no-op script both ways: the native call is what every
+    // apply uses, the tool is how scripts used to be run
+    if (parser.isSet(compareDbusOption)) {
+        if (!WallpaperCore::PlasmaShell::isAvailable()) {
+            qCritical() << "Error: plasmashell is not running on the session bus.";
+            return 1;
+        }
+        
+        const QString script = "print('')";
+        const int rounds = 20;
+        auto report = [](const char* name, std::vector<qint64>& samples) {
+            if (samples.empty()) {
+                qInfo().noquote() << QString("  %1 failed").arg(name, -6);
+                return;
+            }
+            std::sort(samples.begin(), samples.end());
+            qInfo().noquote() << QString("  %1 median %2 ms  min %3 ms")
+                .arg(name, -6)
+                .arg(samples[samples.size() / 2] / 1e6, 7, 'f', 2)
+                .arg(samples.front() / 1e6, 7, 'f', 2);
+        };
+        
+        qInfo() << "Running a no-op Plasma script" << rounds << "times each way:";
+        std::vector<qint64> native;
+        for (int round = 0; round < rounds; ++round) {
+            QElapsedTimer timer;
+            timer.start();
+            QDBusPendingCall call = WallpaperCore::PlasmaShell::evaluateScript(script, 10000);
+            call.waitForFinished();
+            if (call.isError()) {
+                qWarning() << "DBus call failed:" << call.error().message();
+                native.clear();
+                break;
+            }
+            native.push_back(timer.nsecsElapsed());
+        }
+        report("dbus", native);
+        
+        std::vector<qint64> tool;
+        for (int round = 0; round < rounds; ++round) {
+            QElapsedTimer timer;
+            timer.start();
+            if (!WallpaperCore::PlasmaShell::evaluateScriptWithTool(script, 10000)) {
+                tool.clear();
+                break;
+            }
+            tool.push_back(timer.nsecsElapsed());
+        }
+        report("qdbus", tool);
+        return 0;
+    }
+    
     // Check required options
-    if (!parser.isSet(imageOption)) {
+    if (!parser.isSet(imageOption) && !parser.isSet(batchOption)) {
         qCritical() << "Error: Input image file is required. Use -i option.";
         parser.showHelp(1);
     }
@@ -65,6 +316,18 @@ int main(int argc, char *argv[])
     QString imagePath = parser.value(imageOption);
     QString outputDir = parser.value(outputOption);
     
+    // A source piped in is spooled to a temporary file and split like a file
+    const bool fromStdin = imagePath == "-";
+    bool toStreams = parser.isSet(streamOption) || parser.isSet(outputFdsOption);
+    if (fromStdin && (parser.isSet(watchOption) || parser.value(layoutOption) == "-")) {
+        qCritical() << "Error: -i - cannot be combined with --watch or --layout -.";
+        return 1;
+    }
+    if (toStreams && (parser.isSet(applyOption) || parser.isSet(watchOption))) {
+        qCritical() << "Error: --stream and --output-fds cannot be combined with --apply or --watch.";
+        return 1;
+    }
+    
     if (outputDir.isEmpty()) {
         // Use writable location in Flatpak or next to executable as default
         QString appDir = QCoreApplication::applicationDirPath();
@@ -78,7 +341,13 @@ int main(int argc, char *argv[])
     }
     
     // Detect monitors
-    WallpaperCore::MonitorList monitors = detector.detectMonitors();
+    QElapsedTimer layoutTimer;
+    layoutTimer.start();
+    WallpaperCore::MonitorList monitors;
+    if (!loadMonitors(&monitors)) {
+        return 1;
+    }
+    qint64 layoutNs = layoutTimer.nsecsElapsed();
     if (monitors.empty()) {
         qCritical() << "Error: No monitors detected.";
         return 1;
@@ -86,31 +355,366 @@ int main(int argc, char *argv[])
     
     qInfo() << "Detected" << monitors.size() << "monitor(s)";
     
-    // Split image
-    qInfo() << "Splitting image:" << imagePath;
-    if (!splitter.splitImage(imagePath, monitors, outputDir)) {
-        qCritical() << "Error: Failed to split image.";
+    bool jobsOk = false;
+    int jobs = parser.value(jobsOption).toInt(&jobsOk);
+    if (!jobsOk || jobs < 0) {
+        qCritical() << "Error: Invalid value for --jobs:" << parser.value(jobsOption);
+        return 1;
+    }
+    splitter.setThreadCount(jobs);
+    splitter.setScaledDecodeEnabled(!parser.isSet(fullDecodeOption));
+    splitter.setRegionDecodeEnabled(!parser.isSet(noRegionDecodeOption));
+    splitter.setLosslessCropEnabled(!parser.isSet(noLosslessCropOption));
+    // Incremental manifests are keyed by path, which a spooled stdin source
+    // does not keep from one run to the next
+    splitter.setIncrementalEnabled(!fromStdin && (parser.isSet(incrementalOption) || parser.isSet(watchOption)));
+    
+    WallpaperCore::ResampleFilter filter;
+    if (!WallpaperCore::Resampler::parseFilter(parser.value(filterOption), &filter)) {
+        qCritical() << "Error: Unknown resampling filter:" << parser.value(filterOption);
         return 1;
     }
+    splitter.setResampleFilter(filter);
     
-    qInfo() << "Image split successfully. Output directory:" << outputDir;
+    bool memoryLimitOk = false;
+    qint64 memoryLimitMb = parser.value(memoryLimitOption).toLongLong(&memoryLimitOk);
+    if (!memoryLimitOk || memoryLimitMb < 0) {
+        qCritical() << "Error: Invalid value for --memory-limit:" << parser.value(memoryLimitOption);
+        return 1;
+    }
+    splitter.setMemoryLimit(memoryLimitMb << 20);
+    // This process only splits, so Qt may decode anything within the limit
+    WallpaperCore::ImageSplitter::raiseQtAllocationLimit(memoryLimitMb << 20);
     
-    // Apply wallpapers if requested
-    if (parser.isSet(applyOption)) {
-        qInfo() << "Applying wallpapers...";
+    bool cacheLimitOk = false;
+    qint64 cacheLimitMb = parser.value(cacheLimitOption).toLongLong(&cacheLimitOk);
+    if (!cacheLimitOk || cacheLimitMb < 0) {
+        qCritical() << "Error: Invalid value for --cache-limit:" << parser.value(cacheLimitOption);
+        return 1;
+    }
+    splitter.setCacheLimit(cacheLimitMb << 20);
+    
+    bool decodedCacheOk = false;
+    qint64 decodedCacheMb = parser.value(decodedCacheOption).toLongLong(&decodedCacheOk);
+    if (!decodedCacheOk || decodedCacheMb < 0) {
+        qCritical() << "Error: Invalid value for --decoded-cache:" << parser.value(decodedCacheOption);
+        return 1;
+    }
+    splitter.setDecodedCacheLimit(decodedCacheMb << 20);
+    
+    WallpaperCore::OutputFormat format;
+    if (!WallpaperCore::ImageEncoder::parseFormat(parser.value(formatOption), &format)) {
+        qCritical() << "Error: Unknown output format:" << parser.value(formatOption);
+        return 1;
+    }
+    splitter.setOutputFormat(format);
+    
+    bool qualityOk = false;
+    int quality = parser.value(qualityOption).toInt(&qualityOk);
+    if (!qualityOk || quality < -1 || quality > 100) {
+        qCritical() << "Error: Invalid value for --quality:" << parser.value(qualityOption);
+        return 1;
+    }
+    splitter.setOutputQuality(quality);
+    
+    WallpaperCore::JpegOptions jpegOptions;
+    if (!WallpaperCore::ImageEncoder::parseSubsampling(parser.value(subsamplingOption), &jpegOptions.subsampling)) {
+        qCritical() << "Error: Invalid value for --jpeg-subsampling:" << parser.value(subsamplingOption);
+        return 1;
+    }
+    jpegOptions.fastDct = parser.isSet(fastDctOption);
+    jpegOptions.progressive = parser.isSet(progressiveOption);
+    splitter.setJpegOptions(jpegOptions);
+    qDebug() << "JPEG backend:" << (WallpaperCore::ImageEncoder::hasTurboJpeg() ? "libjpeg-turbo" : "Qt");
+    
+    // Split many inputs in one process and report the throughput
+    if (parser.isSet(batchOption)) {
+        bool batchDecodedOk = false;
+        int batchDecoded = parser.value(batchDecodedOption).toInt(&batchDecodedOk);
+        if (!batchDecodedOk || batchDecoded < 1) {
+            qCritical() << "Error: Invalid value for --batch-decoded:" << parser.value(batchDecodedOption);
+            return 1;
+        }
+        
+        QStringList inputs = WallpaperCore::BatchSplitter::collectInputs(parser.value(batchOption));
+        if (inputs.isEmpty()) {
+            qCritical() << "Error: No input images found in" << parser.value(batchOption);
+            return 1;
+        }
+        
+        WallpaperCore::BatchSplitter batch;
+        batch.copySettingsFrom(splitter);
+        batch.setThreadCount(jobs);
+        batch.setMaxDecodedImages(batchDecoded);
+        
+        qInfo() << "Splitting" << inputs.size() << "image(s) into" << outputDir;
+        bool batchOk = batch.run(inputs, monitors, outputDir);
+        
+        const WallpaperCore::BatchStats& stats = batch.stats();
+        double seconds = qMax<qint64>(stats.wallNs, 1) / 1e9;
+        qInfo().noquote() << QString("Split %1, up to date %2, failed %3 of %4 image(s) in %5 s")
+            .arg(stats.split).arg(stats.upToDate).arg(stats.failed).arg(stats.images)
+            .arg(seconds, 0, 'f', 2);
+        qInfo().noquote() << QString("Throughput: %1 images/s, %2 MB/s in, %3 MB/s out")
+            .arg(stats.split / seconds, 0, 'f', 2)
+            .arg(stats.inputBytes / double(1 << 20) / seconds, 0, 'f', 1)
+            .arg(stats.outputBytes / double(1 << 20) / seconds, 0, 'f', 1);
+        qInfo().noquote() << QString("Stage time (all workers): decode %1 ms, scale %2 ms, encode %3 ms")
+            .arg(stats.decodeNs / 1e6, 0, 'f', 1)
+            .arg(stats.scaleNs / 1e6, 0, 'f', 1)
+            .arg(stats.encodeNs / 1e6, 0, 'f', 1);
+        return batchOk ? 0 : 1;
+    }
+    
+    // Spool stdin to a temporary file so a piped source gets the memory
+    // limit, scaled decode, streaming and lossless crops of a file. Its
+    // cache identity is a hash of its contents, copied in bounded chunks.
+    QTemporaryFile stdinFile;
+    QByteArray stdinId;
+    if (fromStdin && !parser.isSet(batchOption)) {
+        QFile input;
+        if (!input.open(stdin, QIODevice::ReadOnly)) {
+            qCritical() << "Error: Cannot read stdin:" << input.errorString();
+            return 1;
+        }
+        if (!stdinFile.open()) {
+            qCritical() << "Error: Cannot create a temporary file for stdin:" << stdinFile.errorString();
+            return 1;
+        }
+        
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        QByteArray chunk;
+        do {
+            chunk = input.read(1 << 20);
+            hash.addData(chunk);
+            if (stdinFile.write(chunk) != chunk.size()) {
+                qCritical() << "Error: Cannot spool stdin:" << stdinFile.errorString();
+                return 1;
+            }
+        } while (!chunk.isEmpty());
+        if (input.error() != QFileDevice::NoError || !stdinFile.flush()) {
+            qCritical() << "Error: Cannot spool stdin:" << input.errorString() << stdinFile.errorString();
+            return 1;
+        }
+        
+        stdinId = "stdin:" + hash.result();
+        imagePath = stdinFile.fileName();
+    }
+    auto splitInput = [&](const QString& dir) {
+        return fromStdin ? splitter.splitImage(imagePath, stdinId, monitors, dir)
+                         : splitter.splitImage(imagePath, monitors, dir);
+    };
+    
+    // Encode every monitor's output in every format and report the cost
+    if (parser.isSet(compareFormatsOption)) {
+        QImage source = WallpaperCore::ImageSplitter::loadImage(imagePath);
+        if (source.isNull() || !splitter.validateImage(source, monitors)) {
+            return 1;
+        }
+        
+        // Crop and scale once up front so only encoding is timed
+        std::shared_ptr<const WallpaperCore::SplitPlan> plan = splitter.planFor(source.size(), monitors);
+        std::vector<QImage> outputs;
+        for (const auto& monitorPlan : plan->monitors()) {
+            QImage crop = WallpaperCore::ImageSplitter::cropView(source, monitorPlan.cropRect);
+            outputs.push_back(WallpaperCore::Resampler::scaled(crop, monitorPlan.targetSize, filter));
+        }
+        
+        const WallpaperCore::OutputFormat formats[] = {
+            WallpaperCore::OutputFormat::Jpeg, WallpaperCore::OutputFormat::Png,
+            WallpaperCore::OutputFormat::Bmp, WallpaperCore::OutputFormat::Ppm,
+            WallpaperCore::OutputFormat::Qoi
+        };
+        const int rounds = 3;
+        
+        qInfo() << "Encoding" << outputs.size() << "monitor image(s), best of" << rounds << "rounds:";
+        for (WallpaperCore::OutputFormat candidate : formats) {
+            qint64 bestNs = -1;
+            qint64 bytes = 0;
+            for (int round = 0; round < rounds; ++round) {
+                bytes = 0;
+                QElapsedTimer timer;
+                timer.start();
+                for (const QImage& output : outputs) {
+                    QBuffer buffer;
+                    buffer.open(QIODevice::WriteOnly);
+                    if (!WallpaperCore::ImageEncoder::write(output, &buffer, candidate, quality, jpegOptions)) {
+                        bytes = -1;
+                        break;
+                    }
+                    bytes += buffer.size();
+                }
+                qint64 elapsed = timer.nsecsElapsed();
+                if (bestNs < 0 || elapsed < bestNs) {
+                    bestNs = elapsed;
+                }
+            }
+            
+            if (bytes < 0) {
+                qInfo().noquote() << QString("  %1 not available").arg(WallpaperCore::ImageEncoder::formatName(candidate), -5);
+                continue;
+            }
+            qInfo().noquote() << QString("  %1 %2 ms  %3 MB")
+                .arg(WallpaperCore::ImageEncoder::formatName(candidate), -5)
+                .arg(bestNs / 1e6, 8, 'f', 1)
+                .arg(bytes / double(1 << 20), 7, 'f', 2);
+        }
+        return 0;
+    }
+    
+    // Hand the encoded outputs to the caller without touching the output
+    // directory. The source is split like any file, into a temporary
+    // directory, and only one encoded output is held in memory at a time.
+    if (toStreams) {
+        QStringList fds;
+        if (parser.isSet(outputFdsOption)) {
+            fds = parser.value(outputFdsOption).split(',', Qt::SkipEmptyParts);
+            if (fds.size() != static_cast<int>(monitors.size())) {
+                qCritical() << "Error: --output-fds needs one descriptor per monitor (" << monitors.size() << ")";
+                return 1;
+            }
+        }
+        
+        QTemporaryDir streamDir;
+        if (!streamDir.isValid()) {
+            qCritical() << "Error: Cannot create a temporary directory:" << streamDir.errorString();
+            return 1;
+        }
+        std::shared_ptr<const WallpaperCore::SplitPlan> plan =
+            splitter.planFor(QImageReader(imagePath).size(), monitors);
+        if (!splitInput(streamDir.path()) || !plan->isValid()) {
+            qCritical() << "Error: Failed to split image.";
+            return 1;
+        }
+        
+        QFile stdoutFile;
+        if (fds.isEmpty() && !stdoutFile.open(stdout, QIODevice::WriteOnly)) {
+            qCritical() << "Error: Cannot write stdout:" << stdoutFile.errorString();
+            return 1;
+        }
         
-        // Update monitor wallpaper paths to use individual split images with index-based naming
-        for (int i = 0; i < monitors.size(); ++i) {
-            monitors[i].wallpaperPath = outputDir + QString("/wallpaper_%1.jpg").arg(i);
+        for (const auto& result : splitter.lastResults()) {
+            QFile encoded(result.outputPath);
+            if (!encoded.open(QIODevice::ReadOnly)) {
+                qCritical() << "Error: Cannot read" << result.outputPath << ":" << encoded.errorString();
+                return 1;
+            }
+            QByteArray data = encoded.readAll();
+            const WallpaperCore::MonitorPlan& monitorPlan = plan->monitors()[result.index];
+            
+            if (fds.isEmpty()) {
+                if (!writeFrame(&stdoutFile, monitorPlan, data, format)) {
+                    qCritical() << "Error: Cannot write stdout:" << stdoutFile.errorString();
+                    return 1;
+                }
+                continue;
+            }
+            
+            bool fdOk = false;
+            int fd = fds[result.index].trimmed().toInt(&fdOk);
+            QFile output;
+            if (!fdOk || !output.open(fd, QIODevice::WriteOnly, QFileDevice::AutoCloseHandle) ||
+                output.write(data) != data.size()) {
+                qCritical() << "Error: Cannot write monitor" << result.index
+                            << "to file descriptor" << fds[result.index] << ":" << output.errorString();
+                return 1;
+            }
         }
+        stdoutFile.flush();
+        return 0;
+    }
+    
+    // Split image, and apply it if requested
+    bool firstRun = true;
+    auto splitAndApply = [&]() -> int {
+        QElapsedTimer stageTimer;
+        stageTimer.start();
+        qint64 applyNs = 0;
+        
+        qInfo() << "Splitting image:" << imagePath;
+        bool splitOk = splitInput(outputDir);
+        qint64 splitNs = stageTimer.nsecsElapsed();
         
-        if (!applier.applyWallpapers(monitors)) {
-            qWarning() << "Warning: Some wallpapers failed to apply.";
+        // Startup and layout only count for the first run
+        auto printTimings = [&]() {
+            if (!parser.isSet(timingsOption)) {
+                return;
+            }
+            QString stages = QString("split %1 ms, apply %2 ms")
+                .arg(splitNs / 1e6, 0, 'f', 1).arg(applyNs / 1e6, 0, 'f', 1);
+            if (firstRun) {
+                stages = QString("startup %1 ms, layout %2 ms, %3, total %4 ms")
+                    .arg(startupNs / 1e6, 0, 'f', 1).arg(layoutNs / 1e6, 0, 'f', 1)
+                    .arg(stages).arg(processTimer.nsecsElapsed() / 1e6, 0, 'f', 1);
+            }
+            qInfo().noquote() << "Timings:" << stages;
+            firstRun = false;
+        };
+        
+        for (const auto& result : splitter.lastResults()) {
+            qInfo() << "  " << result.index << ":" << result.monitor.name
+                    << (result.success ? (result.reused ? "unchanged" : "ok") : "FAILED")
+                    << "->" << result.outputPath;
+        }
+        
+        if (!splitOk) {
+            qCritical() << "Error: Failed to split image.";
+            printTimings();
             return 1;
         }
         
-        qInfo() << "Wallpapers applied successfully.";
+        qInfo() << (splitter.lastSplitCached() ? "Reused cached split. Output directory:"
+                                               : "Image split successfully. Output directory:")
+                << outputDir;
+        
+        // Apply wallpapers if requested
+        if (parser.isSet(applyOption)) {
+            qInfo() << "Applying wallpapers...";
+            
+            // Point every monitor at its own split image
+            QElapsedTimer applyTimer;
+            applyTimer.start();
+            bool applied = applier.applyWallpapers(splitter.lastOutputMonitors());
+            applyNs = applyTimer.nsecsElapsed();
+            if (!applied) {
+                qWarning() << "Warning: Some wallpapers failed to apply.";
+                printTimings();
+                return 1;
+            }
+            
+            qInfo() << "Wallpapers applied successfully.";
+        }
+        
+        printTimings();
+        return 0;
+    };
+    
+    int result = splitAndApply();
+    if (!parser.isSet(watchOption)) {
+        return result;
     }
     
-    return 0;
-} 
\ No newline at end of file
+    // Editors save in bursts (truncate, write, rename), so changes are
+    // collected for a moment before splitting again
+    QFileSystemWatcher watcher;
+    QTimer debounce;
+    debounce.setSingleShot(true);
+    debounce.setInterval(300);
+    
+    watcher.addPath(imagePath);
+    QObject::connect(&watcher, &QFileSystemWatcher::fileChanged, &debounce, [&debounce]() {
+        debounce.start();
+    });
+    QObject::connect(&debounce, &QTimer::timeout, [&]() {
+        // A save that replaced the file drops it from the watcher
+        if (!watcher.files().contains(imagePath) && QFileInfo::exists(imagePath)) {
+            watcher.addPath(imagePath);
+        }
+        if (QFileInfo::exists(imagePath)) {
+            splitAndApply();
+        }
+    });
+    
+    qInfo() << "Watching" << imagePath << "for changes (Ctrl+C to stop)";
+    return app->exec();
+}
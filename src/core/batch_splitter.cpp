@@ -0,0 +1,274 @@
+#include "core/batch_splitter.h"
+#include "core/image_encoder.h"
+#include "core/split_cache.h"
+#include "core/split_plan.h"
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QSemaphore>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+#include <atomic>
+#include <memory>
+
+namespace WallpaperCore {
+
+namespace {
+
+// Totals updated concurrently by the workers of one run
+struct BatchCounters {
+    std::atomic<int> split{0};
+    std::atomic<int> upToDate{0};
+    std::atomic<int> failed{0};
+    std::atomic<qint64> inputBytes{0};
+    std::atomic<qint64> outputBytes{0};
+    std::atomic<qint64> decodeNs{0};
+    std::atomic<qint64> scaleNs{0};
+    std::atomic<qint64> encodeNs{0};
+};
+
+// A decoded source shared by the tasks of its monitors. The last task to
+// finish frees the pixels and hands the decode slot to the next image.
+struct DecodedSource {
+    QString path;
+    QString key;
+    QImage image;
+    std::shared_ptr<const SplitPlan> plan;
+    std::atomic<int> remaining{0};
+    std::atomic<bool> failed{false};
+};
+
+} // namespace
+
+BatchSplitter::BatchSplitter()
+    : m_maxDecodedImages(DefaultMaxDecodedImages)
+{
+}
+
+bool BatchSplitter::run(const QStringList& inputPaths,
+                        const MonitorList& monitors,
+                        const QString& outputDir)
+{
+    m_stats = BatchStats();
+    m_stats.images = inputPaths.size();
+
+    if (monitors.empty()) {
+        qWarning() << "No monitors provided for image splitting";
+        return false;
+    }
+
+    if (!QDir().mkpath(outputDir)) {
+        qWarning() << "Cannot create output directory:" << outputDir;
+        return false;
+    }
+
+    QElapsedTimer wallTimer;
+    wallTimer.start();
+
+    // Eviction waits until the whole batch is written (see below)
+    SplitCache cache(outputDir, cacheLimit());
+    const QString extension = ImageEncoder::extension(outputFormat());
+    const int monitorCount = static_cast<int>(monitors.size());
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(threadCount() > 0 ? threadCount() : QThread::idealThreadCount());
+    QSemaphore decodeSlots(m_maxDecodedImages);
+    BatchCounters counters;
+
+    // Scale and encode one monitor of a decoded source
+    auto monitorTask = [&](const std::shared_ptr<DecodedSource>& source, const MonitorPlan& monitorPlan) {
+        QString outputPath = cache.outputPath(source->key, monitorPlan.index, extension);
+        QImage region = cropView(source->image, monitorPlan.cropRect);
+        bool scaled = region.size() != monitorPlan.targetSize;
+
+        QElapsedTimer timer;
+        timer.start();
+        QImage output = renderMonitor(region, monitorPlan);
+        counters.scaleNs += timer.nsecsElapsed();
+
+        bool saved = false;
+        if (output.isNull()) {
+            qWarning() << "Failed to scale image for monitor" << monitorPlan.monitor.name;
+        } else {
+            timer.restart();
+            saved = ImageEncoder::save(output, outputPath, outputFormat(), outputQuality(), jpegOptions());
+            counters.encodeNs += timer.nsecsElapsed();
+            if (scaled) {
+                bufferPool().release(std::move(output));
+            }
+            if (saved) {
+                counters.outputBytes += QFileInfo(outputPath).size();
+            } else {
+                qWarning() << "Failed to save image:" << outputPath;
+            }
+        }
+
+        if (!saved) {
+            source->failed = true;
+        }
+        if (--source->remaining > 0) {
+            return;
+        }
+
+        // Last monitor of this source
+        if (source->failed) {
+            qWarning() << "Failed to split" << source->path;
+            cache.remove(source->key);
+            ++counters.failed;
+        } else {
+            qDebug() << "Split" << source->path;
+            ++counters.split;
+        }
+        source->image = QImage();
+        decodeSlots.release();
+    };
+
+    // Look an input up in the cache, otherwise decode it and queue its
+    // monitors behind whatever the pool is already working on
+    auto imageTask = [&](const QString& path) {
+        QImageReader reader(path);
+        QSize sourceSize = reader.size();
+        if (!sourceSize.isValid()) {
+            qWarning() << "Cannot read image size of" << path << ":" << reader.errorString();
+            ++counters.failed;
+            decodeSlots.release();
+            return;
+        }
+        if (!validateImageSize(sourceSize, monitors)) {
+            ++counters.failed;
+            decodeSlots.release();
+            return;
+        }
+
+        QString key = cacheKey(SplitCache::fileFingerprint(path), sourceSize, monitors,
+                               streamsSource(reader, sourceSize, monitors));
+        if (!cache.lookup(key, monitorCount, extension).isEmpty()) {
+            ++counters.upToDate;
+            decodeSlots.release();
+            return;
+        }
+
+        int factor = isScaledDecodeEnabled() ? scaledDecodeFactor(reader.format(), sourceSize, monitors) : 1;
+        QSize decodeSize((sourceSize.width() + factor - 1) / factor,
+                         (sourceSize.height() + factor - 1) / factor);
+        qint64 fileBytes = QFileInfo(path).size();
+
+        // A source above the memory ceiling is streamed on this worker by a
+        // splitter of its own instead of being held decoded
+        qint64 decodedBytes = qint64(decodeSize.width()) * decodeSize.height() * 4;
+        if (memoryLimit() > 0 && decodedBytes > memoryLimit()) {
+            ImageSplitter streaming;
+            streaming.copySettingsFrom(*this);
+            streaming.setThreadCount(1);
+            streaming.setCacheLimit(0);
+            streaming.setDecodedCacheLimit(0);
+            streaming.setIncrementalEnabled(false);
+
+            QElapsedTimer timer;
+            timer.start();
+            bool ok = streaming.splitImage(path, monitors, outputDir);
+            counters.decodeNs += timer.nsecsElapsed();
+            if (ok) {
+                ++counters.split;
+                counters.inputBytes += fileBytes;
+                for (const auto& result : streaming.lastResults()) {
+                    counters.outputBytes += QFileInfo(result.outputPath).size();
+                }
+            } else {
+                ++counters.failed;
+            }
+            decodeSlots.release();
+            return;
+        }
+
+        auto source = std::make_shared<DecodedSource>();
+        source->path = path;
+        source->key = key;
+
+        QElapsedTimer timer;
+        timer.start();
+        source->image = factor > 1 ? loadImage(path, decodeSize) : loadImage(path);
+        counters.decodeNs += timer.nsecsElapsed();
+        if (source->image.isNull()) {
+            ++counters.failed;
+            decodeSlots.release();
+            return;
+        }
+        counters.inputBytes += fileBytes;
+
+        source->plan = planFor(source->image.size(), monitors);
+        if (!source->plan->isValid()) {
+            qWarning() << "No valid split plan for" << source->image.size();
+            ++counters.failed;
+            decodeSlots.release();
+            return;
+        }
+
+        source->remaining = static_cast<int>(source->plan->monitors().size());
+        for (const MonitorPlan& monitorPlan : source->plan->monitors()) {
+            pool.start([&monitorTask, source, monitorPlan]() { monitorTask(source, monitorPlan); });
+        }
+    };
+
+    // Decodes are only queued while a slot is free, so finished monitors
+    // make room for the next image before it is read
+    for (const QString& path : inputPaths) {
+        decodeSlots.acquire();
+        pool.start([&imageTask, path]() { imageTask(path); });
+    }
+    pool.waitForDone();
+
+    cache.evict();
+
+    m_stats.split = counters.split;
+    m_stats.upToDate = counters.upToDate;
+    m_stats.failed = counters.failed;
+    m_stats.inputBytes = counters.inputBytes;
+    m_stats.outputBytes = counters.outputBytes;
+    m_stats.decodeNs = counters.decodeNs;
+    m_stats.scaleNs = counters.scaleNs;
+    m_stats.encodeNs = counters.encodeNs;
+    m_stats.wallNs = wallTimer.nsecsElapsed();
+    return m_stats.failed == 0;
+}
+
+QStringList BatchSplitter::collectInputs(const QString& dirOrList)
+{
+    QStringList inputs;
+    QFileInfo info(dirOrList);
+
+    if (info.isDir()) {
+        QStringList filters;
+        for (const QByteArray& format : QImageReader::supportedImageFormats()) {
+            filters << "*." + QString::fromLatin1(format);
+        }
+        QDir dir(dirOrList);
+        const QStringList names = dir.entryList(filters, QDir::Files | QDir::Readable, QDir::Name);
+        for (const QString& name : names) {
+            inputs << dir.filePath(name);
+        }
+        return inputs;
+    }
+
+    QFile file(dirOrList);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qWarning() << "Cannot open batch list:" << dirOrList;
+        return inputs;
+    }
+
+    QDir base = info.absoluteDir();
+    QTextStream stream(&file);
+    while (!stream.atEnd()) {
+        QString line = stream.readLine().trimmed();
+        if (!line.isEmpty() && !line.startsWith('#')) {
+            inputs << QDir::cleanPath(base.filePath(line));
+        }
+    }
+    return inputs;
+}
+
+} // namespace WallpaperCore
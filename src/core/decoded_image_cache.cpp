@@ -0,0 +1,280 @@
+#include "core/decoded_image_cache.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace WallpaperCore {
+
+namespace {
+
+// Pixels start on their own page so the mapping of row 0 is page-aligned
+constexpr qint64 HeaderSize = 4096;
+constexpr char Magic[8] = {'W', 'S', 'D', 'E', 'C', 'O', 'D', '1'};
+
+struct EntryHeader {
+    char magic[8];
+    quint32 format;
+    qint32 width;
+    qint32 height;
+    qint32 reserved;
+    qint64 bytesPerLine;
+    char sourceHash[20];
+};
+static_assert(sizeof(EntryHeader) <= HeaderSize, "header must fit its page");
+
+// <40 hex digit source hash>.pixels
+const QRegularExpression& cacheFilePattern()
+{
+    static const QRegularExpression pattern("^[0-9a-f]{40}\\.pixels$");
+    return pattern;
+}
+
+// <40 hex digit source hash>.seen
+const QRegularExpression& markerFilePattern()
+{
+    static const QRegularExpression pattern("^[0-9a-f]{40}\\.seen$");
+    return pattern;
+}
+
+// Keeps the file open, and with it the mapping, until the last QImage
+// sharing the pixels is gone
+void unmapEntry(void* info)
+{
+    delete static_cast<QFile*>(info);
+}
+
+} // namespace
+
+DecodedImageCache::DecodedImageCache(const QString& directory, qint64 maxBytes)
+    : m_directory(directory)
+    , m_maxBytes(maxBytes)
+{
+}
+
+QByteArray DecodedImageCache::sourceHash(const QByteArray& sourceId, const QSize& decodeSize)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << sourceId << decodeSize;
+    return QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+}
+
+bool DecodedImageCache::isCacheFileName(const QString& fileName)
+{
+    return cacheFilePattern().match(fileName).hasMatch();
+}
+
+QString DecodedImageCache::filePath(const QByteArray& hash) const
+{
+    return QDir(m_directory).filePath(QString::fromLatin1(hash.toHex()) + ".pixels");
+}
+
+QImage DecodedImageCache::load(const QByteArray& hash)
+{
+    if (hash.size() != 20) {
+        return QImage();
+    }
+
+    QFile* file = new QFile(filePath(hash));
+    if (!file->open(QIODevice::ReadOnly) || file->size() < HeaderSize) {
+        delete file;
+        return QImage();
+    }
+
+    EntryHeader header;
+    if (file->read(reinterpret_cast<char*>(&header), sizeof(header)) != qint64(sizeof(header)) ||
+        std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 ||
+        std::memcmp(header.sourceHash, hash.constData(), sizeof(header.sourceHash)) != 0 ||
+        header.format == QImage::Format_Invalid || header.format >= QImage::NImageFormats ||
+        header.width <= 0 || header.height <= 0 || header.bytesPerLine <= 0 ||
+        file->size() != HeaderSize + header.bytesPerLine * header.height) {
+        qWarning() << "Ignoring damaged decoded image cache entry" << file->fileName();
+        delete file;
+        return QImage();
+    }
+
+    const uchar* pixels = file->map(HeaderSize, header.bytesPerLine * header.height);
+    if (!pixels) {
+        qWarning() << "Cannot map decoded image cache entry" << file->fileName() << ":" << file->errorString();
+        delete file;
+        return QImage();
+    }
+
+    // Modification times double as the LRU order
+    file->setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+
+    QImage image(pixels, header.width, header.height, header.bytesPerLine,
+                 static_cast<QImage::Format>(header.format), unmapEntry, file);
+    if (image.isNull()) {
+        delete file;
+    }
+    return image;
+}
+
+bool DecodedImageCache::store(const QByteArray& hash, const QImage& image)
+{
+    if (hash.size() != 20 || image.isNull() || image.colorCount() > 0) {
+        return false;
+    }
+
+    qint64 pixelBytes = image.sizeInBytes();
+    if (m_maxBytes > 0 && HeaderSize + pixelBytes > m_maxBytes) {
+        return false;
+    }
+
+    QDir dir(m_directory);
+    if (!dir.exists()) {
+        dir.mkpath(".");
+    }
+
+    QByteArray headerPage(HeaderSize, '\0');
+    EntryHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.format = static_cast<quint32>(image.format());
+    header.width = image.width();
+    header.height = image.height();
+    header.bytesPerLine = image.bytesPerLine();
+    std::memcpy(header.sourceHash, hash.constData(), sizeof(header.sourceHash));
+    std::memcpy(headerPage.data(), &header, sizeof(header));
+
+    // Written under a temporary name and renamed, so a reader never maps a
+    // half-written entry
+    QSaveFile file(filePath(hash));
+    if (!file.open(QIODevice::WriteOnly) ||
+        file.write(headerPage) != HeaderSize ||
+        file.write(reinterpret_cast<const char*>(image.constBits()), pixelBytes) != pixelBytes ||
+        !file.commit()) {
+        qWarning() << "Failed to write decoded image cache entry" << file.fileName() << ":" << file.errorString();
+        return false;
+    }
+
+    evict(hash);
+    return true;
+}
+
+bool DecodedImageCache::noteSplit(const QByteArray& hash)
+{
+    if (hash.size() != 20) {
+        return false;
+    }
+
+    QString markerPath = QDir(m_directory).filePath(QString::fromLatin1(hash.toHex()) + ".seen");
+    QFile marker(markerPath);
+    if (marker.exists()) {
+        // Modification times keep the markers of recent sources on pruning
+        if (marker.open(QIODevice::ReadOnly)) {
+            marker.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+        }
+        return true;
+    }
+
+    QDir dir(m_directory);
+    if (!dir.exists()) {
+        dir.mkpath(".");
+    }
+    if (!marker.open(QIODevice::WriteOnly)) {
+        qWarning() << "Cannot write decoded image cache marker" << markerPath << ":" << marker.errorString();
+        return false;
+    }
+    marker.close();
+
+    pruneMarkers();
+    return false;
+}
+
+void DecodedImageCache::pruneMarkers()
+{
+    std::vector<QFileInfo> markers;
+    const QFileInfoList files = QDir(m_directory).entryInfoList(QDir::Files);
+    for (const QFileInfo& fileInfo : files) {
+        if (markerFilePattern().match(fileInfo.fileName()).hasMatch()) {
+            markers.push_back(fileInfo);
+        }
+    }
+
+    if (markers.size() <= size_t(MaxMarkers)) {
+        return;
+    }
+
+    std::sort(markers.begin(), markers.end(), [](const QFileInfo& a, const QFileInfo& b) {
+        return a.lastModified() < b.lastModified();
+    });
+    for (size_t i = 0; i < markers.size() - size_t(MaxMarkers); ++i) {
+        QFile::remove(markers[i].filePath());
+    }
+}
+
+void DecodedImageCache::evict(const QByteArray& keepHash)
+{
+    if (m_maxBytes <= 0) {
+        return;
+    }
+
+    QString keepName = keepHash.isEmpty() ? QString() : QString::fromLatin1(keepHash.toHex()) + ".pixels";
+    std::vector<QFileInfo> entries;
+    qint64 total = 0;
+    const QFileInfoList files = QDir(m_directory).entryInfoList(QDir::Files);
+    for (const QFileInfo& fileInfo : files) {
+        if (isCacheFileName(fileInfo.fileName())) {
+            entries.push_back(fileInfo);
+            total += fileInfo.size();
+        }
+    }
+
+    if (total <= m_maxBytes) {
+        return;
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const QFileInfo& a, const QFileInfo& b) {
+        return a.lastModified() < b.lastModified();
+    });
+
+    // Images still mapped by a splitter stay readable after the unlink
+    for (const QFileInfo& entry : entries) {
+        if (total <= m_maxBytes) {
+            break;
+        }
+        if (entry.fileName() == keepName) {
+            continue;
+        }
+
+        QFile::remove(entry.filePath());
+        total -= entry.size();
+        qDebug() << "Evicted decoded image" << entry.fileName() << "(" << entry.size() / (1 << 20) << "MB)";
+    }
+}
+
+qint64 DecodedImageCache::totalBytes() const
+{
+    qint64 total = 0;
+    const QFileInfoList files = QDir(m_directory).entryInfoList(QDir::Files);
+    for (const QFileInfo& fileInfo : files) {
+        if (isCacheFileName(fileInfo.fileName())) {
+            total += fileInfo.size();
+        }
+    }
+    return total;
+}
+
+void DecodedImageCache::clear()
+{
+    QDir dir(m_directory);
+    const QStringList files = dir.entryList(QDir::Files);
+    for (const QString& fileName : files) {
+        if (isCacheFileName(fileName) || markerFilePattern().match(fileName).hasMatch()) {
+            dir.remove(fileName);
+        }
+    }
+}
+
+} // namespace WallpaperCore
@@ -0,0 +1,68 @@
+#include "core/image_buffer_pool.h"
+#include <QMutexLocker>
+
+namespace WallpaperCore {
+
+ImageBufferPool::ImageBufferPool(qint64 maxBytes, int maxBuffersPerBucket)
+    : m_maxBytes(maxBytes)
+    , m_maxBuffersPerBucket(maxBuffersPerBucket)
+    , m_pooledBytes(0)
+{
+}
+
+QImage ImageBufferPool::acquire(const QSize& size, QImage::Format format)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_buckets.find(bucketKey(size, format));
+        if (it != m_buckets.end() && !it.value().empty()) {
+            QImage image = std::move(it.value().back());
+            it.value().pop_back();
+            m_pooledBytes -= image.sizeInBytes();
+            return image;
+        }
+    }
+
+    return QImage(size, format);
+}
+
+void ImageBufferPool::release(QImage&& image)
+{
+    if (image.isNull() || !image.isDetached()) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    qint64 bytes = image.sizeInBytes();
+    if (m_pooledBytes + bytes > m_maxBytes) {
+        return;
+    }
+
+    std::vector<QImage>& bucket = m_buckets[bucketKey(image.size(), image.format())];
+    if (static_cast<int>(bucket.size()) >= m_maxBuffersPerBucket) {
+        return;
+    }
+
+    bucket.push_back(std::move(image));
+    m_pooledBytes += bytes;
+}
+
+void ImageBufferPool::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_buckets.clear();
+    m_pooledBytes = 0;
+}
+
+qint64 ImageBufferPool::pooledBytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_pooledBytes;
+}
+
+quint64 ImageBufferPool::bucketKey(const QSize& size, QImage::Format format)
+{
+    return (quint64(size.width()) << 36) | (quint64(size.height()) << 8) | quint64(format);
+}
+
+} // namespace WallpaperCore
\ No newline at end of file
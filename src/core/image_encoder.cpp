@@ -0,0 +1,334 @@
+#include "core/image_encoder.h"
+#include "core/turbo_jpeg.h"
+#include <QByteArray>
+#include <QDebug>
+#include <QSaveFile>
+#include <QImageWriter>
+#include <QIODevice>
+#include <cstring>
+
+namespace WallpaperCore {
+
+namespace {
+
+// QOI chunk tags
+constexpr uchar QoiOpIndex = 0x00;
+constexpr uchar QoiOpDiff = 0x40;
+constexpr uchar QoiOpLuma = 0x80;
+constexpr uchar QoiOpRun = 0xc0;
+constexpr uchar QoiOpRgb = 0xfe;
+constexpr uchar QoiOpRgba = 0xff;
+constexpr int QoiMaxRun = 62;
+
+struct QoiPixel {
+    uchar r = 0;
+    uchar g = 0;
+    uchar b = 0;
+    uchar a = 255;
+
+    bool operator==(const QoiPixel& other) const
+    {
+        return r == other.r && g == other.g && b == other.b && a == other.a;
+    }
+};
+
+inline int qoiHash(const QoiPixel& pixel)
+{
+    return (pixel.r * 3 + pixel.g * 5 + pixel.b * 7 + pixel.a * 11) % 64;
+}
+
+inline void putBigEndian32(uchar* out, quint32 value)
+{
+    out[0] = uchar(value >> 24);
+    out[1] = uchar(value >> 16);
+    out[2] = uchar(value >> 8);
+    out[3] = uchar(value);
+}
+
+} // namespace
+
+bool ImageEncoder::write(const QImage& image, QIODevice* device,
+                         OutputFormat format, int quality,
+                         const JpegOptions& jpegOptions)
+{
+    if (image.isNull() || !device) {
+        return false;
+    }
+
+    if (format == OutputFormat::Qoi) {
+        return writeQoi(image, device);
+    }
+
+    if (quality < 0) {
+        quality = defaultQuality(format);
+    }
+
+    if (format == OutputFormat::Jpeg && TurboJpeg::isAvailable()) {
+        return TurboJpeg::encode(image, device, quality, jpegOptions);
+    }
+
+    QImageWriter writer(device, formatName(format).toLatin1());
+    if (format == OutputFormat::Jpeg || format == OutputFormat::Png) {
+        // For PNG Qt maps quality onto the zlib level (100 -> 0, 0 -> 9)
+        writer.setQuality(quality);
+    }
+    if (format == OutputFormat::Jpeg) {
+        writer.setProgressiveScanWrite(jpegOptions.progressive);
+    }
+
+    if (!writer.write(image)) {
+        qWarning() << "Failed to encode image as" << formatName(format) << ":" << writer.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+bool ImageEncoder::save(const QImage& image, const QString& path,
+                        OutputFormat format, int quality,
+                        const JpegOptions& jpegOptions)
+{
+    // Written to a temporary file and renamed into place, so a reader never
+    // sees a partially written image
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to open" << path << "for writing:" << file.errorString();
+        return false;
+    }
+
+    if (!write(image, &file, format, quality, jpegOptions)) {
+        file.cancelWriting();
+        return false;
+    }
+
+    if (!file.commit()) {
+        qWarning() << "Failed to write" << path << ":" << file.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+bool ImageEncoder::writeQoi(const QImage& image, QIODevice* device)
+{
+    if (image.isNull() || !device) {
+        return false;
+    }
+
+    // QOI stores straight (non-premultiplied) RGBA
+    const bool hasAlpha = image.hasAlphaChannel();
+    const QImage::Format pixelFormat = hasAlpha ? QImage::Format_ARGB32 : QImage::Format_RGB32;
+    const QImage source = image.format() == pixelFormat ? image : image.convertToFormat(pixelFormat);
+    if (source.isNull()) {
+        return false;
+    }
+
+    const int width = source.width();
+    const int height = source.height();
+    const int channels = hasAlpha ? 4 : 3;
+
+    // Worst case: every pixel is an RGBA chunk
+    QByteArray data;
+    data.resize(14 + qsizetype(width) * height * (channels + 1) + 8);
+    uchar* out = reinterpret_cast<uchar*>(data.data());
+    uchar* start = out;
+
+    // Header: magic, dimensions, channels, sRGB colour space
+    memcpy(out, "qoif", 4);
+    putBigEndian32(out + 4, quint32(width));
+    putBigEndian32(out + 8, quint32(height));
+    out[12] = uchar(channels);
+    out[13] = 0;
+    out += 14;
+
+    // The index starts as transparent black (all zeros), the previous
+    // pixel as opaque black, as the spec requires
+    QoiPixel index[64];
+    for (QoiPixel& entry : index) {
+        entry.a = 0;
+    }
+    QoiPixel previous;
+    int run = 0;
+
+    for (int y = 0; y < height; ++y) {
+        const QRgb* line = reinterpret_cast<const QRgb*>(source.constScanLine(y));
+        for (int x = 0; x < width; ++x) {
+            QoiPixel pixel;
+            pixel.r = uchar(qRed(line[x]));
+            pixel.g = uchar(qGreen(line[x]));
+            pixel.b = uchar(qBlue(line[x]));
+            pixel.a = hasAlpha ? uchar(qAlpha(line[x])) : uchar(255);
+
+            if (pixel == previous) {
+                if (++run == QoiMaxRun) {
+                    *out++ = QoiOpRun | uchar(run - 1);
+                    run = 0;
+                }
+                continue;
+            }
+
+            if (run > 0) {
+                *out++ = QoiOpRun | uchar(run - 1);
+                run = 0;
+            }
+
+            const int hash = qoiHash(pixel);
+            if (index[hash] == pixel) {
+                *out++ = QoiOpIndex | uchar(hash);
+            } else {
+                index[hash] = pixel;
+
+                if (pixel.a == previous.a) {
+                    // Differences wrap around like the decoder's uint8 arithmetic
+                    const int dr = qint8(pixel.r - previous.r);
+                    const int dg = qint8(pixel.g - previous.g);
+                    const int db = qint8(pixel.b - previous.b);
+                    const int drg = dr - dg;
+                    const int dbg = db - dg;
+
+                    if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                        *out++ = QoiOpDiff | uchar((dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+                    } else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7) {
+                        *out++ = QoiOpLuma | uchar(dg + 32);
+                        *out++ = uchar((drg + 8) << 4 | (dbg + 8));
+                    } else {
+                        *out++ = QoiOpRgb;
+                        *out++ = pixel.r;
+                        *out++ = pixel.g;
+                        *out++ = pixel.b;
+                    }
+                } else {
+                    *out++ = QoiOpRgba;
+                    *out++ = pixel.r;
+                    *out++ = pixel.g;
+                    *out++ = pixel.b;
+                    *out++ = pixel.a;
+                }
+            }
+
+            previous = pixel;
+        }
+    }
+
+    if (run > 0) {
+        *out++ = QoiOpRun | uchar(run - 1);
+    }
+
+    // End marker: seven zero bytes and a one
+    static const uchar padding[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+    memcpy(out, padding, sizeof(padding));
+    out += sizeof(padding);
+
+    const qint64 size = out - start;
+    if (device->write(data.constData(), size) != size) {
+        qWarning() << "Failed to write QOI image:" << device->errorString();
+        return false;
+    }
+
+    return true;
+}
+
+bool ImageEncoder::hasTurboJpeg()
+{
+    return TurboJpeg::isAvailable();
+}
+
+int ImageEncoder::defaultQuality(OutputFormat format)
+{
+    switch (format) {
+    case OutputFormat::Jpeg:
+        return 95;
+    case OutputFormat::Png:
+        return 80;
+    case OutputFormat::Bmp:
+    case OutputFormat::Ppm:
+    case OutputFormat::Qoi:
+        break;
+    }
+    return -1;
+}
+
+QString ImageEncoder::extension(OutputFormat format)
+{
+    switch (format) {
+    case OutputFormat::Jpeg:
+        return "jpg";
+    case OutputFormat::Png:
+        return "png";
+    case OutputFormat::Bmp:
+        return "bmp";
+    case OutputFormat::Ppm:
+        return "ppm";
+    case OutputFormat::Qoi:
+        return "qoi";
+    }
+    return QString();
+}
+
+QString ImageEncoder::formatName(OutputFormat format)
+{
+    switch (format) {
+    case OutputFormat::Jpeg:
+        return "jpeg";
+    case OutputFormat::Png:
+        return "png";
+    case OutputFormat::Bmp:
+        return "bmp";
+    case OutputFormat::Ppm:
+        return "ppm";
+    case OutputFormat::Qoi:
+        return "qoi";
+    }
+    return QString();
+}
+
+bool ImageEncoder::parseFormat(const QString& name, OutputFormat* format)
+{
+    const OutputFormat formats[] = {
+        OutputFormat::Jpeg, OutputFormat::Png, OutputFormat::Bmp,
+        OutputFormat::Ppm, OutputFormat::Qoi
+    };
+
+    for (OutputFormat candidate : formats) {
+        if (name.compare(formatName(candidate), Qt::CaseInsensitive) == 0 ||
+            name.compare(extension(candidate), Qt::CaseInsensitive) == 0) {
+            if (format) {
+                *format = candidate;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+QString ImageEncoder::subsamplingName(ChromaSubsampling subsampling)
+{
+    switch (subsampling) {
+    case ChromaSubsampling::S444:
+        return "444";
+    case ChromaSubsampling::S422:
+        return "422";
+    case ChromaSubsampling::S420:
+        return "420";
+    }
+    return QString();
+}
+
+bool ImageEncoder::parseSubsampling(const QString& name, ChromaSubsampling* subsampling)
+{
+    const ChromaSubsampling values[] = {
+        ChromaSubsampling::S444, ChromaSubsampling::S422, ChromaSubsampling::S420
+    };
+
+    for (ChromaSubsampling candidate : values) {
+        if (name == subsamplingName(candidate)) {
+            if (subsampling) {
+                *subsampling = candidate;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace WallpaperCore
@@ -1,23 +1,408 @@
 #include "core/image_splitter.h"
+#include "core/turbo_jpeg.h"
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDataStream>
 #include <QDebug>
 #include <QDir>
+#include <QFile>
 #include <QFileInfo>
 #include <QImage>
+#include <QImageReader>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QPainter>
+#include <QSaveFile>
+#include <QThread>
+#include <QThreadPool>
 #include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
 
 namespace WallpaperCore {
 
+ImageSplitter::ImageSplitter()
+    : m_threadCount(0)
+    , m_scaledDecodeEnabled(true)
+    , m_regionDecodeEnabled(true)
+    , m_losslessCropEnabled(true)
+    , m_memoryLimit(DefaultMemoryLimit)
+    , m_resampleFilter(ResampleFilter::Bilinear)
+    , m_outputFormat(OutputFormat::Jpeg)
+    , m_outputQuality(-1)
+    , m_cacheLimit(SplitCache::DefaultMaxBytes)
+    , m_decodedCacheLimit(0)
+    , m_incrementalEnabled(false)
+    , m_lastSplitCached(false)
+    , m_cancelFlag(nullptr)
+{
+}
+
+ImageSplitter::~ImageSplitter() = default;
+
 bool ImageSplitter::splitImage(const QString& inputPath, 
                               const MonitorList& monitors,
                               const QString& outputDir)
 {
+    return splitImage(inputPath, SplitCache::fileFingerprint(inputPath), monitors, outputDir);
+}
+
+bool ImageSplitter::splitImage(const QString& inputPath,
+                              const QByteArray& sourceId,
+                              const MonitorList& monitors,
+                              const QString& outputDir)
+{
+    m_lastResults.clear();
+    m_lastSplitCached = false;
+    m_lastCacheKey.clear();
+    
     if (monitors.empty()) {
         qWarning() << "No monitors provided for image splitting";
         return false;
     }
     
-    if (!validateImage(inputPath, monitors)) {
+    QFileInfo fileInfo(inputPath);
+    if (!fileInfo.exists() || !fileInfo.isReadable()) {
+        qWarning() << "Image file does not exist or is not readable:" << inputPath;
+        return false;
+    }
+    
+    // Validate from the image header so an undersized image is rejected
+    // without decoding it
+    QImageReader reader(inputPath);
+    QSize sourceSize = reader.size();
+    if (sourceSize.isValid() && !validateImageSize(sourceSize, monitors)) {
+        return false;
+    }
+    
+    // A source already split for this layout and these settings is served
+    // from the output cache without decoding anything
+    SplitCache cache(outputDir, m_cacheLimit);
+    QString key = cacheKey(sourceId, sourceSize, monitors,
+                           streamsSource(reader, sourceSize, monitors));
+    m_lastCacheKey = key;
+    if (sourceSize.isValid() && loadCachedResults(cache, key, sourceSize, monitors)) {
+        return true;
+    }
+    
+    return finishSplit(cache, key,
+                       splitFile(inputPath, sourceId, reader, sourceSize, monitors, outputDir, key));
+}
+
+bool ImageSplitter::splitFile(const QString& inputPath,
+                             const QByteArray& sourceId,
+                             QImageReader& reader,
+                             const QSize& sourceSize,
+                             const MonitorList& monitors,
+                             const QString& outputDir,
+                             const QString& key)
+{
+    // When every output is at least 2x smaller than its crop, let the
+    // decoder downscale while decoding (JPEG DCT scaling) instead of
+    // decoding at full resolution and smoothing it down afterwards.
+    int factor = 1;
+    if (m_scaledDecodeEnabled && sourceSize.isValid()) {
+        factor = scaledDecodeFactor(reader.format(), sourceSize, monitors);
+    }
+    
+    QSize decodeSize = sourceSize;
+    if (factor > 1) {
+        decodeSize = QSize((sourceSize.width() + factor - 1) / factor,
+                           (sourceSize.height() + factor - 1) / factor);
+        qDebug() << "Using scaled decode 1/" << factor << "of" << sourceSize << "->" << decodeSize;
+    }
+    
+    // Crops of a JPEG that need no scaling (e.g. a source made for exactly
+    // this desktop) are cut out in the DCT domain without decoding. Any
+    // other monitor decodes just its own region.
+    if (m_losslessCropEnabled && factor == 1 && m_outputFormat == OutputFormat::Jpeg &&
+        sourceSize.isValid() && reader.format() == "jpeg") {
+        QSize mcu = TurboJpeg::mcuSize(inputPath);
+        std::shared_ptr<const SplitPlan> plan = m_planCache.plan(sourceSize, monitors);
+        
+        bool anyLossless = false;
+        if (mcu.isValid() && plan->isValid()) {
+            for (const auto& monitorPlan : plan->monitors()) {
+                anyLossless = anyLossless || canCropLosslessly(monitorPlan, mcu);
+            }
+        }
+        
+        if (anyLossless) {
+            if (!prepareResults(*plan, outputDir, key)) {
+                return false;
+            }
+            
+            qDebug() << "Cropping" << inputPath << "losslessly where possible (MCU" << mcu << ")";
+            return runMonitorTasks(*plan, [this, inputPath, mcu](const MonitorPlan& monitorPlan,
+                                                                 const QString& outputPath) {
+                if (canCropLosslessly(monitorPlan, mcu) &&
+                    TurboJpeg::cropLossless(inputPath, monitorPlan.cropRect, outputPath,
+                                            m_jpegOptions.progressive)) {
+                    qDebug() << "Losslessly cropped" << monitorPlan.cropRect << "for monitor"
+                             << monitorPlan.monitor.name << "to" << outputPath;
+                    return true;
+                }
+                
+                QImage region = loadImageRegion(inputPath, monitorPlan.cropRect);
+                if (region.isNull()) {
+                    return false;
+                }
+                return writeMonitorImage(region, monitorPlan, outputPath);
+            });
+        }
+    }
+    
+    // Incremental splits compare region fingerprints of the decoded source
+    // against the previous version of the file
+    QString manifest;
+    if (m_incrementalEnabled && sourceSize.isValid()) {
+        manifest = manifestPath(inputPath, sourceSize, monitors, outputDir);
+    }
+    
+    // A source decoded before, e.g. before a monitor was toggled, is mapped
+    // from the decoded image cache instead of being decoded again
+    DecodedImageCache decodedCache(decodedCacheDirectory(outputDir), m_decodedCacheLimit);
+    QByteArray decodedHash;
+    if (m_decodedCacheLimit > 0 && sourceSize.isValid()) {
+        decodedHash = DecodedImageCache::sourceHash(sourceId, decodeSize);
+        QImage cached = decodedCache.load(decodedHash);
+        if (!cached.isNull()) {
+            qDebug() << "Mapped decoded" << inputPath << "from the decoded image cache";
+            return manifest.isEmpty() ? splitSource(cached, monitors, outputDir, key)
+                                      : splitSourceIncremental(cached, monitors, outputDir, key, manifest);
+        }
+    }
+    
+    // Sources whose decoded bitmap would exceed the memory ceiling are
+    // decoded once, top to bottom, in scanline stripes that every monitor
+    // scales its rows from, so any size can be split in bounded memory
+    bool clipSupported = reader.supportsOption(QImageIOHandler::ClipRect);
+    qint64 decodedBytes = qint64(decodeSize.width()) * decodeSize.height() * 4;
+    bool oversized = m_memoryLimit > 0 && sourceSize.isValid() && decodedBytes > m_memoryLimit;
+    if (oversized && streamsSource(reader, sourceSize, monitors)) {
+        TurboJpeg::ScanlineDecoder decoder(inputPath, factor > 1 ? decodeSize : QSize());
+        if (decoder.isOpen() && decoder.size() == decodeSize) {
+            std::shared_ptr<const SplitPlan> plan = m_planCache.plan(decodeSize, monitors);
+            if (!prepareResults(*plan, outputDir, key)) {
+                return false;
+            }
+            
+            qDebug() << "Streaming" << inputPath << "(" << decodedBytes / (1 << 20)
+                     << "MB decoded) in stripes under" << m_memoryLimit / (1 << 20) << "MB";
+            std::vector<QImage> outputs;
+            if (!streamSource(decoder, *plan, &outputs)) {
+                return false;
+            }
+            return runMonitorTasks(*plan, [this, &outputs](const MonitorPlan& monitorPlan,
+                                                           const QString& outputPath) {
+                return writeMonitorImage(outputs[monitorPlan.index], monitorPlan, outputPath);
+            });
+        }
+    }
+    
+    // Without a sequential decoder every stripe would decode the file from
+    // its start again, so each monitor's region is decoded once instead
+    bool regionOnly = oversized && clipSupported;
+    if (oversized) {
+        qWarning() << "Image format of" << inputPath << "cannot be decoded in stripes;"
+                   << (regionOnly ? "decoding each monitor's region of" : "decoding")
+                   << decodedBytes / (1 << 20) << "MB above the memory limit";
+    }
+    
+    // Region decodes leave nothing whole to cache, so with the decoded image
+    // cache on, a source that fits it and was split before is decoded in one
+    // piece instead. A first split keeps region decode and is only noted.
+    bool cacheDecoded = !decodedHash.isEmpty() && decodedBytes <= m_decodedCacheLimit
+                        && decodedCache.noteSplit(decodedHash);
+    
+    // With parallel workers and a decoder that can clip natively, every
+    // worker decodes only its own monitor's region. Memory per worker then
+    // stays proportional to one monitor rather than the whole image.
+    bool regionDecode = regionOnly || (m_regionDecodeEnabled && sourceSize.isValid()
+                                       && !cacheDecoded && manifest.isEmpty()
+                                       && monitors.size() > 1
+                                       && effectiveThreadCount(static_cast<int>(monitors.size())) > 1
+                                       && clipSupported);
+    
+    if (regionDecode) {
+        std::shared_ptr<const SplitPlan> plan = m_planCache.plan(decodeSize, monitors);
+        if (!prepareResults(*plan, outputDir, key)) {
+            return false;
+        }
+        
+        qDebug() << "Decoding each monitor's region of" << inputPath << "separately";
+        bool scaled = factor > 1;
+        return runMonitorTasks(*plan, [this, inputPath, decodeSize, scaled](const MonitorPlan& monitorPlan,
+                                                                            const QString& outputPath) {
+            QImage region = loadImageRegion(inputPath, monitorPlan.cropRect,
+                                            scaled ? decodeSize : QSize());
+            if (region.isNull()) {
+                return false;
+            }
+            return writeMonitorImage(region, monitorPlan, outputPath);
+        });
+    }
+    
+    // Decode once; validation and every monitor work from this image
+    QImage source = factor > 1 ? loadImage(inputPath, decodeSize) : loadImage(inputPath);
+    if (source.isNull()) {
+        return false;
+    }
+    
+    bool success = manifest.isEmpty() ? splitSource(source, monitors, outputDir, key)
+                                      : splitSourceIncremental(source, monitors, outputDir, key, manifest);
+    
+    // Written on this thread once the outputs are, so a split that stores
+    // its source takes as long as writing the decoded image to disk
+    if (success && cacheDecoded && source.size() == decodeSize) {
+        decodedCache.store(decodedHash, source);
+    }
+    return success;
+}
+
+bool ImageSplitter::splitImage(const QImage& source,
+                              const MonitorList& monitors,
+                              const QString& outputDir)
+{
+    m_lastResults.clear();
+    m_lastSplitCached = false;
+    m_lastCacheKey.clear();
+    
+    if (monitors.empty()) {
+        qWarning() << "No monitors provided for image splitting";
+        return false;
+    }
+    
+    if (!validateImage(source, monitors)) {
+        return false;
+    }
+    
+    // Without a file to identify it the image is keyed by its pixels
+    SplitCache cache(outputDir, m_cacheLimit);
+    QString key = cacheKey(imageFingerprint(source), source.size(), monitors);
+    m_lastCacheKey = key;
+    if (loadCachedResults(cache, key, source.size(), monitors)) {
+        return true;
+    }
+    
+    return finishSplit(cache, key, splitSource(source, monitors, outputDir, key));
+}
+
+bool ImageSplitter::splitSource(const QImage& source,
+                               const MonitorList& monitors,
+                               const QString& outputDir,
+                               const QString& key)
+{
+    // Crop rects and target sizes only depend on the source size and the
+    // layout, so they are computed once and reused across wallpaper changes
+    std::shared_ptr<const SplitPlan> plan = m_planCache.plan(source.size(), monitors);
+    if (!prepareResults(*plan, outputDir, key)) {
+        return false;
+    }
+    
+    // The source is only read, so every monitor can crop from it concurrently
+    return runMonitorTasks(*plan, [this, &source](const MonitorPlan& monitorPlan,
+                                                  const QString& outputPath) {
+        return splitImageForMonitor(source, monitorPlan, outputPath);
+    });
+}
+
+bool ImageSplitter::splitSourceIncremental(const QImage& source,
+                                          const MonitorList& monitors,
+                                          const QString& outputDir,
+                                          const QString& key,
+                                          const QString& manifestPath)
+{
+    std::shared_ptr<const SplitPlan> plan = m_planCache.plan(source.size(), monitors);
+    if (!prepareResults(*plan, outputDir, key)) {
+        return false;
+    }
+    
+    // Outputs and region fingerprints of the previous split of this file
+    SplitCache cache(outputDir);
+    QString extension = ImageEncoder::extension(m_outputFormat);
+    QString previousKey;
+    QStringList previousRegions;
+    QFile manifestFile(manifestPath);
+    if (manifestFile.open(QIODevice::ReadOnly)) {
+        QJsonObject manifest = QJsonDocument::fromJson(manifestFile.readAll()).object();
+        previousKey = manifest.value("key").toString();
+        for (const QJsonValue& region : manifest.value("regions").toArray()) {
+            previousRegions << region.toString();
+        }
+    }
+    
+    const int count = static_cast<int>(m_lastResults.size());
+    std::vector<QString> regions(count);
+    std::vector<char> reused(count, 0);
+    bool ok = runMonitorTasks(*plan, [&](const MonitorPlan& monitorPlan, const QString& outputPath) {
+        QImage region = cropView(source, monitorPlan.cropRect);
+        QString fingerprint = QString::fromLatin1(imageFingerprint(region).toHex());
+        regions[monitorPlan.index] = fingerprint;
+        
+        if (!previousKey.isEmpty() && previousKey != key &&
+            monitorPlan.index < previousRegions.size() &&
+            previousRegions[monitorPlan.index] == fingerprint) {
+            QString previousPath = cache.outputPath(previousKey, monitorPlan.index, extension);
+            QFile::remove(outputPath);
+            if (QFile::copy(previousPath, outputPath)) {
+                reused[monitorPlan.index] = 1;
+                return true;
+            }
+        }
+        
+        return writeMonitorImage(region, monitorPlan, outputPath);
+    });
+    
+    int reusedCount = 0;
+    for (int i = 0; i < count; ++i) {
+        m_lastResults[i].reused = reused[i] != 0;
+        reusedCount += reused[i];
+    }
+    qDebug() << "Incremental split:" << count - reusedCount << "of" << count << "monitor(s) changed";
+    
+    if (!ok) {
+        return false;
+    }
+    
+    // Record this version for the next save of the file
+    QJsonArray regionArray;
+    for (const QString& fingerprint : regions) {
+        regionArray.append(fingerprint);
+    }
+    QJsonObject manifest;
+    manifest.insert("key", key);
+    manifest.insert("regions", regionArray);
+    
+    QDir().mkpath(QFileInfo(manifestPath).absolutePath());
+    QSaveFile output(manifestPath);
+    if (!output.open(QIODevice::WriteOnly) ||
+        output.write(QJsonDocument(manifest).toJson(QJsonDocument::Compact)) < 0 ||
+        !output.commit()) {
+        qWarning() << "Failed to write split manifest" << manifestPath << ":" << output.errorString();
+    }
+    
+    return true;
+}
+
+QString ImageSplitter::manifestPath(const QString& inputPath,
+                                    const QSize& sourceSize,
+                                    const MonitorList& monitors,
+                                    const QString& outputDir) const
+{
+    QString id = cacheKey(QFileInfo(inputPath).canonicalFilePath().toUtf8(), sourceSize, monitors);
+    return QDir(manifestDirectory(outputDir)).filePath(id + ".json");
+}
+
+bool ImageSplitter::prepareResults(const SplitPlan& plan,
+                                  const QString& outputDir,
+                                  const QString& key)
+{
+    if (!plan.isValid()) {
+        qWarning() << "No valid split plan for" << plan.sourceSize();
         return false;
     }
     
@@ -26,59 +411,300 @@ bool ImageSplitter::splitImage(const QString& inputPath,
         dir.mkpath(".");
     }
     
-    // Sort monitors by x position (left to right)
-    MonitorList sortedMonitors = monitors;
-    std::sort(sortedMonitors.begin(), sortedMonitors.end(), 
-              [](const MonitorInfo& a, const MonitorInfo& b) {
-                  return a.geometry.x() < b.geometry.x();
-              });
+    qDebug() << "Monitors in split order (left to right, top to bottom):";
+    for (const auto& monitorPlan : plan.monitors()) {
+        qDebug() << "  " << monitorPlan.index << ":" << monitorPlan.monitor.name
+                 << "at" << monitorPlan.monitor.geometry << "crop" << monitorPlan.cropRect;
+    }
+    
+    // Outputs are named after the split's cache key, so every distinct
+    // split has its own file names: <key>_0.jpg, <key>_1.jpg, ...
+    SplitCache cache(outputDir);
+    QString extension = ImageEncoder::extension(m_outputFormat);
+    m_lastResults.assign(plan.monitors().size(), MonitorSplitResult());
+    for (int i = 0; i < static_cast<int>(plan.monitors().size()); ++i) {
+        MonitorSplitResult& result = m_lastResults[i];
+        result.monitor = plan.monitors()[i].monitor;
+        result.index = i;
+        result.outputPath = cache.outputPath(key, i, extension);
+    }
+    
+    return true;
+}
+
+bool ImageSplitter::loadCachedResults(SplitCache& cache,
+                                     const QString& key,
+                                     const QSize& sourceSize,
+                                     const MonitorList& monitors)
+{
+    std::shared_ptr<const SplitPlan> plan = m_planCache.plan(sourceSize, monitors);
+    if (!plan->isValid()) {
+        return false;
+    }
     
-    qDebug() << "Monitors sorted by x position:";
-    for (int i = 0; i < sortedMonitors.size(); ++i) {
-        qDebug() << "  " << i << ":" << sortedMonitors[i].name 
-                 << "at x=" << sortedMonitors[i].geometry.x();
+    int count = static_cast<int>(plan->monitors().size());
+    QStringList paths = cache.lookup(key, count, ImageEncoder::extension(m_outputFormat));
+    if (paths.isEmpty() || !prepareResults(*plan, cache.directory(), key)) {
+        return false;
     }
     
-    // Determine which prefix to use (alternate between a_ and b_)
-    QString prefix = "a_";
-    QFileInfo testFileA(dir.filePath("a_wallpaper_0.jpg"));
-    QFileInfo testFileB(dir.filePath("b_wallpaper_0.jpg"));
+    for (auto& result : m_lastResults) {
+        result.success = true;
+    }
+    m_lastSplitCached = true;
     
-    if (testFileA.exists() && testFileB.exists()) {
-        // Both exist, use the opposite of the newer one
-        if (testFileA.lastModified() > testFileB.lastModified()) {
-            prefix = "b_";  // a_ is newer, so use b_
-            qDebug() << "Found existing a_ files (newer), switching to b_ prefix";
-        } else {
-            prefix = "a_";  // b_ is newer, so use a_
-            qDebug() << "Found existing b_ files (newer), switching to a_ prefix";
-        }
-    } else if (testFileA.exists()) {
-        prefix = "b_";
-        qDebug() << "Found existing a_ files, switching to b_ prefix";
-    } else if (testFileB.exists()) {
-        prefix = "a_";
-        qDebug() << "Found existing b_ files, switching to a_ prefix";
+    qDebug() << "Using cached split" << key << "for" << count << "monitor(s)";
+    return true;
+}
+
+bool ImageSplitter::finishSplit(SplitCache& cache, const QString& key, bool success)
+{
+    if (success) {
+        cache.evict({key, m_keepKey});
     } else {
-        // No files exist, start with a_
-        prefix = "a_";
-        qDebug() << "No existing files found, using a_ prefix";
+        // Never leave a partial split behind for a later lookup to find
+        cache.remove(key);
+    }
+    
+    return success;
+}
+
+QString ImageSplitter::cacheKey(const QByteArray& sourceId,
+                                const QSize& sourceSize,
+                                const MonitorList& monitors,
+                                bool streamed) const
+{
+    // Everything that changes the output pixels or their encoding
+    QByteArray parameters;
+    QDataStream stream(&parameters, QIODevice::WriteOnly);
+    stream << sourceId
+           << SplitPlan::layoutKey(sourceSize, monitors)
+           << static_cast<int>(m_outputFormat)
+           << m_outputQuality
+           << static_cast<int>(m_jpegOptions.subsampling)
+           << m_jpegOptions.fastDct
+           << m_jpegOptions.progressive
+           << static_cast<int>(m_resampleFilter)
+           << m_scaledDecodeEnabled
+           << m_losslessCropEnabled
+           << m_regionDecodeEnabled
+           << streamed;
+    
+    return SplitCache::keyFor(parameters);
+}
+
+bool ImageSplitter::streamsSource(QImageReader& reader,
+                                  const QSize& sourceSize,
+                                  const MonitorList& monitors) const
+{
+    if (m_memoryLimit <= 0 || !sourceSize.isValid() || reader.format() != "jpeg" ||
+        !TurboJpeg::ScanlineDecoder::isAvailable()) {
+        return false;
+    }
+    
+    int factor = m_scaledDecodeEnabled ? scaledDecodeFactor(reader.format(), sourceSize, monitors) : 1;
+    qint64 decodedBytes = qint64((sourceSize.width() + factor - 1) / factor)
+                          * ((sourceSize.height() + factor - 1) / factor) * 4;
+    return decodedBytes > m_memoryLimit;
+}
+
+QByteArray ImageSplitter::imageFingerprint(const QImage& image)
+{
+    QByteArray header;
+    QDataStream stream(&header, QIODevice::WriteOnly);
+    stream << image.size() << static_cast<int>(image.format());
+    
+    // SHA-1 like SplitCache::keyFor(), so a fingerprint is the same on every
+    // machine and can be kept in manifests. Rows are hashed one by one so
+    // padding bytes at the end of each line are ignored.
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(header);
+    const qsizetype rowBytes = qsizetype(image.width()) * image.depth() / 8;
+    for (int y = 0; y < image.height(); ++y) {
+        hash.addData(QByteArrayView(image.constScanLine(y), rowBytes));
+    }
+    
+    return hash.result();
+}
+
+MonitorList ImageSplitter::lastOutputMonitors() const
+{
+    MonitorList monitors;
+    for (const auto& result : m_lastResults) {
+        if (result.success) {
+            MonitorInfo monitor = result.monitor;
+            monitor.wallpaperPath = result.outputPath;
+            monitors.push_back(monitor);
+        }
+    }
+    return monitors;
+}
+
+bool ImageSplitter::runMonitorTasks(const SplitPlan& plan, const MonitorTask& task)
+{
+    // Each task writes to its own result slot
+    auto cancelled = [this]() { return m_cancelFlag && m_cancelFlag->load(); };
+    runParallel(static_cast<int>(m_lastResults.size()), [this, &plan, &task, &cancelled](int i) {
+        MonitorSplitResult& result = m_lastResults[i];
+        result.success = !cancelled() && task(plan.monitors()[result.index], result.outputPath);
+    });
+    
+    if (cancelled()) {
+        qDebug() << "Split cancelled";
+        return false;
     }
     
-    // Create individual split images for each monitor
     bool allSuccess = true;
+    for (const auto& result : m_lastResults) {
+        if (!result.success) {
+            qWarning() << "Failed to split image for monitor:" << result.monitor.name;
+            allSuccess = false;
+        }
+    }
+    
+    return allSuccess;
+}
+
+void ImageSplitter::runParallel(int count, const std::function<void(int index)>& task)
+{
+    int workers = effectiveThreadCount(count);
+    if (workers <= 1) {
+        for (int i = 0; i < count; ++i) {
+            task(i);
+        }
+        return;
+    }
+    
+    if (!m_threadPool) {
+        m_threadPool = std::make_unique<QThreadPool>();
+    }
+    m_threadPool->setMaxThreadCount(workers);
+    
+    for (int i = 0; i < count; ++i) {
+        m_threadPool->start([&task, i]() { task(i); });
+    }
+    m_threadPool->waitForDone();
+}
+
+bool ImageSplitter::splitToImages(const QImage& source,
+                                 const MonitorList& monitors,
+                                 std::vector<MonitorImage>* images,
+                                 std::vector<QImage>* destinations)
+{
+    images->clear();
+    if (monitors.empty()) {
+        qWarning() << "No monitors provided for image splitting";
+        return false;
+    }
+    if (!validateImage(source, monitors)) {
+        return false;
+    }
+    
+    std::shared_ptr<const SplitPlan> plan = m_planCache.plan(source.size(), monitors);
+    if (!plan->isValid()) {
+        qWarning() << "No valid split plan for" << source.size();
+        return false;
+    }
     
-    for (int i = 0; i < sortedMonitors.size(); ++i) {
-        const auto& monitor = sortedMonitors[i];
-        // Use alternating prefix naming: a_wallpaper_0.jpg or b_wallpaper_0.jpg
-        QString outputPath = dir.filePath(QString("%1wallpaper_%2.jpg").arg(prefix).arg(i));
+    const int count = static_cast<int>(plan->monitors().size());
+    if (destinations && static_cast<int>(destinations->size()) != count) {
+        qWarning() << "Expected" << count << "destination images, got" << destinations->size();
+        return false;
+    }
+    
+    images->resize(count);
+    runParallel(count, [this, &source, &plan, images, destinations](int i) {
+        const MonitorPlan& monitorPlan = plan->monitors()[i];
+        QImage region = cropView(source, monitorPlan.cropRect);
+        QImage* destination = destinations ? &(*destinations)[i] : nullptr;
+        QImage output = renderMonitor(region, monitorPlan, destination);
         
-        if (!splitImageForMonitor(inputPath, monitor, outputPath, i)) {
-            qWarning() << "Failed to split image for monitor:" << monitor.name;
-            allSuccess = false;
+        // An unscaled region still borrows the source's pixels, so the
+        // result gets its own copy
+        bool pooled = !destination && region.size() != monitorPlan.targetSize;
+        if (!destination && !pooled && !output.isNull()) {
+            output = output.copy();
+        }
+        if (output.isNull()) {
+            qWarning() << "Failed to split image for monitor:" << monitorPlan.monitor.name;
         }
+        (*images)[i] = MonitorImage(monitorPlan, std::move(output), pooled);
+    });
+    
+    return std::none_of(images->cbegin(), images->cend(),
+                        [](const MonitorImage& image) { return image.isNull(); });
+}
+
+bool ImageSplitter::splitToImages(const uchar* data,
+                                 const QSize& size,
+                                 qsizetype bytesPerLine,
+                                 QImage::Format format,
+                                 const MonitorList& monitors,
+                                 std::vector<MonitorImage>* images,
+                                 std::vector<QImage>* destinations)
+{
+    // A read-only view; the caller's buffer is never written or copied whole
+    QImage source(data, size.width(), size.height(), bytesPerLine, format);
+    return splitToImages(source, monitors, images, destinations);
+}
+
+void ImageSplitter::recycle(MonitorImage&& image)
+{
+    if (image.isPooled()) {
+        m_bufferPool.release(image.takeImage());
     }
+}
+
+bool ImageSplitter::encodeSplit(const QImage& source,
+                               const MonitorList& monitors,
+                               std::vector<EncodedMonitorImage>* outputs)
+{
+    outputs->clear();
+    if (monitors.empty()) {
+        qWarning() << "No monitors provided for image splitting";
+        return false;
+    }
+    if (!validateImage(source, monitors)) {
+        return false;
+    }
+    
+    std::shared_ptr<const SplitPlan> plan = m_planCache.plan(source.size(), monitors);
+    if (!plan->isValid()) {
+        qWarning() << "No valid split plan for" << source.size();
+        return false;
+    }
+    
+    const int count = static_cast<int>(plan->monitors().size());
+    outputs->resize(count);
+    runParallel(count, [this, &source, &plan, outputs](int i) {
+        const MonitorPlan& monitorPlan = plan->monitors()[i];
+        EncodedMonitorImage& encoded = (*outputs)[i];
+        encoded.plan = monitorPlan;
+        
+        QImage region = cropView(source, monitorPlan.cropRect);
+        bool scaled = region.size() != monitorPlan.targetSize;
+        QImage output = renderMonitor(region, monitorPlan);
+        if (output.isNull()) {
+            qWarning() << "Failed to scale image for monitor" << monitorPlan.monitor.name;
+            return;
+        }
+        
+        QBuffer buffer(&encoded.data);
+        buffer.open(QIODevice::WriteOnly);
+        if (!ImageEncoder::write(output, &buffer, m_outputFormat, m_outputQuality, m_jpegOptions)) {
+            qWarning() << "Failed to encode image for monitor" << monitorPlan.monitor.name;
+            encoded.data.clear();
+        }
+        
+        if (scaled) {
+            m_bufferPool.release(std::move(output));
+        }
+    });
     
+    bool allSuccess = true;
+    for (const auto& encoded : *outputs) {
+        allSuccess = allSuccess && !encoded.data.isEmpty();
+    }
     return allSuccess;
 }
 
@@ -87,42 +713,271 @@ bool ImageSplitter::splitImageForMonitor(const QString& inputPath,
                                         const QString& outputPath,
                                         int monitorIndex)
 {
-    // Load image using Qt
-    QImage image(inputPath);
+    QImage image = loadImage(inputPath);
     if (image.isNull()) {
-        qWarning() << "Failed to load image:" << inputPath;
         return false;
     }
     
-    QSize imageSize = image.size();
+    return splitImageForMonitor(image, monitor, outputPath, monitorIndex);
+}
+
+bool ImageSplitter::splitImageForMonitor(const QImage& image,
+                                        const MonitorInfo& monitor,
+                                        const QString& outputPath,
+                                        int monitorIndex)
+{
+    // Without the rest of the layout the whole image belongs to this monitor
+    SplitPlan plan = SplitPlan::create(image.size(), MonitorList{monitor});
+    if (!plan.isValid()) {
+        qWarning() << "Cannot plan split for monitor:" << monitor.name;
+        return false;
+    }
+    
+    MonitorPlan monitorPlan = plan.monitors().front();
+    monitorPlan.index = monitorIndex;
+    return splitImageForMonitor(image, monitorPlan, outputPath);
+}
+
+bool ImageSplitter::splitImageForMonitor(const QImage& image,
+                                        const MonitorPlan& plan,
+                                        const QString& outputPath)
+{
+    if (plan.cropRect.isEmpty() || plan.targetSize.isEmpty()) {
+        qWarning() << "Empty crop for monitor" << plan.monitor.name << plan.cropRect;
+        return false;
+    }
+    
+    // Crop the image for this monitor without copying its pixels
+    return writeMonitorImage(cropView(image, plan.cropRect), plan, outputPath);
+}
+
+bool ImageSplitter::streamSource(TurboJpeg::ScanlineDecoder& decoder,
+                                const SplitPlan& plan,
+                                std::vector<QImage>* outputs)
+{
+    // Stripes go through the separable resampler, whose output rows depend
+    // only on the source rows under their filter, so the stripes stitch
+    // together into exactly the full-decode output. Qt's smooth scaling has
+    // no such guarantee and is replaced by bilinear here.
+    const ResampleFilter filter = m_resampleFilter == ResampleFilter::QtSmooth
+                                  ? ResampleFilter::Bilinear : m_resampleFilter;
+    const QSize sourceSize = decoder.size();
+    const int count = static_cast<int>(plan.monitors().size());
+    
+    // Every output is held until the end. A JPEG decodes without alpha, as
+    // it does in one piece.
+    outputs->assign(count, QImage());
+    qint64 outputBytes = 0;
+    qint64 intermediateRowBytes = 0;
+    for (int i = 0; i < count; ++i) {
+        const MonitorPlan& monitorPlan = plan.monitors()[i];
+        if (monitorPlan.cropRect.isEmpty() || monitorPlan.targetSize.isEmpty() ||
+            !QRect(QPoint(0, 0), sourceSize).contains(monitorPlan.cropRect)) {
+            qWarning() << "Empty crop for monitor" << monitorPlan.monitor.name << monitorPlan.cropRect;
+            return false;
+        }
+        
+        QImage& output = (*outputs)[i];
+        output = QImage(monitorPlan.targetSize, QImage::Format_RGB32);
+        if (output.isNull()) {
+            qWarning() << "Failed to allocate output for monitor" << monitorPlan.monitor.name
+                       << monitorPlan.targetSize;
+            return false;
+        }
+        outputBytes += output.sizeInBytes();
+        if (monitorPlan.cropRect.size() != monitorPlan.targetSize) {
+            intermediateRowBytes += qint64(monitorPlan.targetSize.width()) * 4;
+        }
+    }
+    
+    // Source rows [*first, *last) that output rows [begin, end) of monitor i
+    // read, in source coordinates
+    auto sourceRows = [&plan, filter](int i, int begin, int end, int* first, int* last) {
+        const MonitorPlan& monitorPlan = plan.monitors()[i];
+        const QRect& crop = monitorPlan.cropRect;
+        if (crop.size() == monitorPlan.targetSize) {
+            *first = begin;
+            *last = end;
+        } else {
+            Resampler::sourceRows(crop.height(), monitorPlan.targetSize.height(), begin, end,
+                                  filter, first, last);
+        }
+        *first += crop.y();
+        *last += crop.y();
+    };
+    
+    // The stripe gets what the outputs leave of the memory limit. Each of
+    // its rows also costs the resampler an intermediate row per scaled
+    // monitor while all monitors scale from it at once.
+    const qint64 rowBytes = qint64(sourceSize.width()) * 4;
+    const qint64 stripeBudget = m_memoryLimit - outputBytes;
+    int capacity = 1;
+    if (stripeBudget > rowBytes + intermediateRowBytes) {
+        capacity = static_cast<int>(qMin<qint64>(stripeBudget / (rowBytes + intermediateRowBytes),
+                                                 sourceSize.height()));
+    } else {
+        qWarning() << "Memory limit" << m_memoryLimit << "is too small for" << outputBytes
+                   << "bytes of outputs - streaming as few rows as possible";
+    }
     
-    // Use the passed monitorIndex directly (0, 1, 2) for simple horizontal splitting
-    // Calculate crop rectangle for simple horizontal splitting (like the reference script)
-    int sectionWidth = imageSize.width() / 3; // 33.33% of image width
-    int cropX = monitorIndex * sectionWidth;
-    int cropY = 0;
-    int cropWidth = sectionWidth;
-    int cropHeight = imageSize.height(); // 100% of image height
+    // Rows [stripeTop, stripeTop + stripeRows) of the source, which are
+    // exactly the rows the decoder returned last
+    QImage stripe;
+    int stripeTop = 0;
+    int stripeRows = 0;
+    std::vector<int> nextRow(count, 0);
+    auto cancelled = [this]() { return m_cancelFlag && m_cancelFlag->load(); };
     
-    // Crop the image for this monitor
-    QImage cropped = image.copy(QRect(cropX, cropY, cropWidth, cropHeight));
+    for (;;) {
+        if (cancelled()) {
+            qDebug() << "Split cancelled";
+            return false;
+        }
+        
+        // The stripe starts at the first row an unfinished output still
+        // needs and must hold any single output row's filter support
+        int top = std::numeric_limits<int>::max();
+        int span = 1;
+        for (int i = 0; i < count; ++i) {
+            if (nextRow[i] < plan.monitors()[i].targetSize.height()) {
+                int first = 0;
+                int last = 0;
+                sourceRows(i, nextRow[i], nextRow[i] + 1, &first, &last);
+                top = qMin(top, first);
+                span = qMax(span, last - first);
+            }
+        }
+        if (top == std::numeric_limits<int>::max()) {
+            break;
+        }
+        if (span > capacity) {
+            qWarning() << "Growing stripe to" << span << "rows above the memory limit";
+            capacity = span;
+        }
+        
+        // Keep the rows the new stripe shares with the previous one
+        int kept = qMax(0, stripeTop + stripeRows - qMax(top, stripeTop));
+        if (stripe.height() < capacity) {
+            QImage grown(sourceSize.width(), capacity, QImage::Format_RGB32);
+            if (grown.isNull()) {
+                qWarning() << "Failed to allocate stripe of" << grown.size();
+                return false;
+            }
+            for (int y = 0; y < kept; ++y) {
+                std::memcpy(grown.scanLine(y), stripe.constScanLine(stripeRows - kept + y), size_t(rowBytes));
+            }
+            stripe = grown;
+        } else if (kept > 0 && kept < stripeRows) {
+            std::memmove(stripe.bits(), stripe.constScanLine(stripeRows - kept),
+                         size_t(stripe.bytesPerLine()) * kept);
+        }
+        stripeTop = kept > 0 ? stripeTop + stripeRows - kept : top;
+        stripeRows = kept;
+        
+        // Rows between two monitors that no output reads are decoded into
+        // the stripe and dropped
+        while (decoder.nextRow() < stripeTop) {
+            if (!decoder.readRow(stripe.bits())) {
+                qWarning() << "Failed to decode row" << decoder.nextRow();
+                return false;
+            }
+        }
+        while (stripeRows < capacity && decoder.nextRow() < sourceSize.height()) {
+            if (!decoder.readRow(stripe.scanLine(stripeRows))) {
+                qWarning() << "Failed to decode row" << decoder.nextRow();
+                return false;
+            }
+            ++stripeRows;
+        }
+        
+        // Every monitor scales all of its rows the stripe covers
+        const int stripeBottom = stripeTop + stripeRows;
+        std::vector<char> failed(count, 0);
+        runParallel(count, [&](int i) {
+            const MonitorPlan& monitorPlan = plan.monitors()[i];
+            const QRect& crop = monitorPlan.cropRect;
+            const QSize& target = monitorPlan.targetSize;
+            QImage& output = (*outputs)[i];
+            
+            int begin = nextRow[i];
+            int end = begin;
+            int first = 0;
+            int last = 0;
+            while (end < target.height()) {
+                sourceRows(i, begin, end + 1, &first, &last);
+                if (first < stripeTop || last > stripeBottom) {
+                    break;
+                }
+                ++end;
+            }
+            if (end == begin) {
+                return;
+            }
+            
+            sourceRows(i, begin, end, &first, &last);
+            const uchar* src = stripe.constScanLine(first - stripeTop) + size_t(crop.x()) * 4;
+            if (crop.size() != target) {
+                if (!Resampler::resampleRows(src, crop.width(), crop.height(), first - crop.y(),
+                                             stripe.bytesPerLine(), output.scanLine(begin),
+                                             target.width(), target.height(), begin, end,
+                                             output.bytesPerLine(), filter)) {
+                    qWarning() << "Failed to scale stripe for monitor" << monitorPlan.monitor.name;
+                    failed[i] = 1;
+                    return;
+                }
+            } else {
+                for (int y = begin; y < end; ++y) {
+                    std::memcpy(output.scanLine(y), src + (y - begin) * stripe.bytesPerLine(),
+                                size_t(crop.width()) * 4);
+                }
+            }
+            nextRow[i] = end;
+        });
+        
+        if (std::find(failed.cbegin(), failed.cend(), 1) != failed.cend()) {
+            return false;
+        }
+    }
     
+    return true;
+}
+
+bool ImageSplitter::canCropLosslessly(const MonitorPlan& plan, const QSize& mcuSize) const
+{
+    // Only the origin has to be aligned; libjpeg-turbo trims partial MCUs
+    // at the right and bottom edges
+    return !plan.needsScaling() && !plan.cropRect.isEmpty() && mcuSize.isValid()
+           && plan.cropRect.x() % mcuSize.width() == 0
+           && plan.cropRect.y() % mcuSize.height() == 0;
+}
+
+bool ImageSplitter::writeMonitorImage(const QImage& region,
+                                     const MonitorPlan& plan,
+                                     const QString& outputPath)
+{
     // Resize to monitor resolution if needed
-    if (cropWidth != monitor.geometry.width() || cropHeight != monitor.geometry.height()) {
-        cropped = cropped.scaled(monitor.geometry.width(), 
-                                monitor.geometry.height(),
-                                Qt::IgnoreAspectRatio,
-                                Qt::SmoothTransformation);
+    bool scaled = region.size() != plan.targetSize;
+    QImage output = renderMonitor(region, plan);
+    if (output.isNull()) {
+        qWarning() << "Failed to scale image for monitor" << plan.monitor.name;
+        return false;
+    }
+    
+    // Save the cropped image in the configured format
+    bool saved = ImageEncoder::save(output, outputPath, m_outputFormat, m_outputQuality, m_jpegOptions);
+    
+    // Scaled outputs are recycled for the next split of the same layout
+    if (scaled) {
+        m_bufferPool.release(std::move(output));
     }
     
-    // Save the cropped image
-    if (!cropped.save(outputPath, "JPEG", 95)) { // 95% quality
+    if (!saved) {
         qWarning() << "Failed to save image:" << outputPath;
         return false;
     }
     
-    qDebug() << "Split image for monitor" << monitor.name 
-             << "(index" << monitorIndex << ") saved to" << outputPath;
+    qDebug() << "Split image for monitor" << plan.monitor.name 
+             << "(index" << plan.index << ") saved to" << outputPath;
     
     return true;
 }
@@ -133,17 +988,14 @@ QSize ImageSplitter::getOptimalImageSize(const MonitorList& monitors)
         return QSize();
     }
     
-    // Calculate the total virtual desktop size
-    int minX = 0, minY = 0, maxX = 0, maxY = 0;
-    
+    // Calculate the total virtual desktop size (bounding box of the given
+    // monitors, which is what the split plan maps onto the image)
+    QRect virtualDesktop;
     for (const auto& monitor : monitors) {
-        minX = qMin(minX, monitor.geometry.x());
-        minY = qMin(minY, monitor.geometry.y());
-        maxX = qMax(maxX, monitor.geometry.x() + monitor.geometry.width());
-        maxY = qMax(maxY, monitor.geometry.y() + monitor.geometry.height());
+        virtualDesktop = virtualDesktop.united(monitor.geometry);
     }
     
-    return QSize(maxX - minX, maxY - minY);
+    return virtualDesktop.size();
 }
 
 bool ImageSplitter::validateImage(const QString& imagePath, 
@@ -155,14 +1007,40 @@ bool ImageSplitter::validateImage(const QString& imagePath,
         return false;
     }
     
-    // Load image using Qt
-    QImage image(imagePath);
+    QImage image = loadImage(imagePath);
     if (image.isNull()) {
-        qWarning() << "Failed to load image:" << imagePath;
         return false;
     }
     
-    QSize imageSize = image.size();
+    return validateImage(image, monitors);
+}
+
+bool ImageSplitter::validateImage(const QImage& image,
+                                 const MonitorList& monitors)
+{
+    if (image.isNull()) {
+        qWarning() << "Cannot validate a null image";
+        return false;
+    }
+    
+    return validateImageSize(image.size(), monitors);
+}
+
+void ImageSplitter::raiseQtAllocationLimit(qint64 bytes)
+{
+    int limitMb = static_cast<int>(qMin<qint64>((qMax<qint64>(0, bytes) + (1 << 20) - 1) >> 20,
+                                                std::numeric_limits<int>::max()));
+    int qtLimitMb = QImageReader::allocationLimit();
+    if (limitMb == 0 && qtLimitMb != 0) {
+        QImageReader::setAllocationLimit(0);
+    } else if (qtLimitMb != 0 && limitMb > qtLimitMb) {
+        QImageReader::setAllocationLimit(limitMb);
+    }
+}
+
+bool ImageSplitter::validateImageSize(const QSize& imageSize,
+                                     const MonitorList& monitors)
+{
     QSize optimalSize = getOptimalImageSize(monitors);
     
     if (imageSize.width() < optimalSize.width() || 
@@ -175,23 +1053,269 @@ bool ImageSplitter::validateImage(const QString& imagePath,
     return true;
 }
 
+QImage ImageSplitter::loadImage(const QString& imagePath)
+{
+    QImage image = TurboJpeg::decode(imagePath);
+    if (!image.isNull()) {
+        return image;
+    }
+    
+    // Load image using Qt
+    image = QImage(imagePath);
+    if (image.isNull()) {
+        qWarning() << "Failed to load image:" << imagePath;
+    }
+    
+    return image;
+}
+
+QImage ImageSplitter::loadImage(const QString& imagePath, const QSize& scaledSize)
+{
+    QImage image = TurboJpeg::decode(imagePath, scaledSize);
+    if (!image.isNull()) {
+        return image;
+    }
+    
+    QImageReader reader(imagePath);
+    if (scaledSize.isValid()) {
+        reader.setScaledSize(scaledSize);
+    }
+    
+    image = reader.read();
+    if (image.isNull()) {
+        qWarning() << "Failed to load image:" << imagePath << reader.errorString();
+    }
+    
+    return image;
+}
+
+QImage ImageSplitter::loadImageData(const QByteArray& data, const QSize& scaledSize)
+{
+    QImage image = TurboJpeg::decode(data, scaledSize);
+    if (!image.isNull()) {
+        return image;
+    }
+    
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+    QImageReader reader(&buffer);
+    if (scaledSize.isValid()) {
+        reader.setScaledSize(scaledSize);
+    }
+    
+    image = reader.read();
+    if (image.isNull()) {
+        qWarning() << "Failed to load image data:" << reader.errorString();
+    }
+    
+    return image;
+}
+
+QImage ImageSplitter::loadImageRegion(const QString& imagePath,
+                                     const QRect& region,
+                                     const QSize& scaledSize)
+{
+    QImageReader reader(imagePath);
+    if (scaledSize.isValid()) {
+        // Clip and scale in one pass; the region is in scaled coordinates
+        reader.setScaledSize(scaledSize);
+        reader.setScaledClipRect(region);
+    } else {
+        reader.setClipRect(region);
+    }
+    
+    QImage image = reader.read();
+    if (image.isNull()) {
+        qWarning() << "Failed to load region" << region << "of image:" << imagePath
+                   << reader.errorString();
+    }
+    
+    return image;
+}
+
+int ImageSplitter::scaledDecodeFactor(const QByteArray& format,
+                                      const QSize& sourceSize,
+                                      const MonitorList& monitors)
+{
+    // Only JPEG downscales during decoding (1/2, 1/4, 1/8 DCT scaling);
+    // other formats would decode at full size and rescale anyway
+    if (format != "jpeg" || sourceSize.isEmpty()) {
+        return 1;
+    }
+    
+    // Crops are proportional to the monitor geometry, so every decoded crop
+    // stays at least as large as its output as long as the decoded image
+    // still covers the virtual desktop at the densest monitor's pixels per
+    // geometry unit (above 1 for scaled outputs)
+    QRect virtualDesktop;
+    double densityX = 1.0;
+    double densityY = 1.0;
+    for (const auto& monitor : monitors) {
+        virtualDesktop = virtualDesktop.united(monitor.geometry);
+        if (!monitor.actualResolution.isEmpty() && !monitor.geometry.isEmpty()) {
+            densityX = qMax(densityX, double(monitor.actualResolution.width()) / monitor.geometry.width());
+            densityY = qMax(densityY, double(monitor.actualResolution.height()) / monitor.geometry.height());
+        }
+    }
+    
+    QSize desktopSize = virtualDesktop.size();
+    if (desktopSize.isEmpty()) {
+        return 1;
+    }
+    
+    int factor = 1;
+    while (factor < 8 &&
+           sourceSize.width() / (factor * 2) >= desktopSize.width() * densityX &&
+           sourceSize.height() / (factor * 2) >= desktopSize.height() * densityY) {
+        factor *= 2;
+    }
+    
+    return factor;
+}
+
 QRect ImageSplitter::calculateCropRect(const QSize& imageSize, 
                                       const MonitorInfo& monitor,
                                       const MonitorList& allMonitors)
 {
-    QSize optimalSize = getOptimalImageSize(allMonitors);
+    QRect virtualDesktop;
+    for (const auto& other : allMonitors) {
+        virtualDesktop = virtualDesktop.united(other.geometry);
+    }
+    
+    return SplitPlan::cropRectFor(imageSize, monitor.geometry, virtualDesktop);
+}
+
+std::shared_ptr<const SplitPlan> ImageSplitter::planFor(const QSize& sourceSize,
+                                                        const MonitorList& monitors)
+{
+    return m_planCache.plan(sourceSize, monitors);
+}
+
+QImage ImageSplitter::scaleImage(const QImage& image, const QSize& size)
+{
+    if (image.size() == size) {
+        return image;
+    }
+    
+    if (m_resampleFilter == ResampleFilter::QtSmooth) {
+        return Resampler::scaled(image, size, m_resampleFilter);
+    }
+    
+    // Resample straight from the (possibly borrowed) source into a pooled
+    // destination buffer
+    QImage destination = m_bufferPool.acquire(size, Resampler::resampleFormat(image));
+    if (destination.isNull() || !Resampler::scaleInto(image, destination, m_resampleFilter)) {
+        return QImage();
+    }
+    
+    return destination;
+}
+
+QImage ImageSplitter::renderMonitor(const QImage& region, const MonitorPlan& plan, QImage* destination)
+{
+    if (!destination) {
+        return scaleImage(region, plan.targetSize);
+    }
+    
+    if (destination->size() != plan.targetSize ||
+        (destination->format() != QImage::Format_RGB32 &&
+         destination->format() != QImage::Format_ARGB32_Premultiplied)) {
+        qWarning() << "Destination for monitor" << plan.monitor.name << "is" << destination->size()
+                   << destination->format() << "but needs" << plan.targetSize << "in RGB32 or ARGB32_Premultiplied";
+        return QImage();
+    }
+    
+    // Resample straight into the caller's buffer where the filter allows it
+    bool scaled = region.size() != plan.targetSize;
+    if (scaled && m_resampleFilter != ResampleFilter::QtSmooth &&
+        Resampler::resampleFormat(region) == destination->format()) {
+        return Resampler::scaleInto(region, *destination, m_resampleFilter) ? *destination : QImage();
+    }
+    
+    // Otherwise scale (or take the region as is) and copy the rows over
+    QImage output = scaled ? scaleImage(region, plan.targetSize) : region;
+    if (output.isNull()) {
+        return QImage();
+    }
     
-    // Calculate the scale factor between image and virtual desktop
-    double scaleX = static_cast<double>(imageSize.width()) / optimalSize.width();
-    double scaleY = static_cast<double>(imageSize.height()) / optimalSize.height();
+    QImage converted = output.format() == destination->format()
+                       ? output : output.convertToFormat(destination->format());
+    const size_t rowBytes = size_t(converted.width()) * converted.depth() / 8;
+    for (int y = 0; y < converted.height(); ++y) {
+        std::memcpy(destination->scanLine(y), converted.constScanLine(y), rowBytes);
+    }
+    
+    if (scaled) {
+        converted = QImage();
+        m_bufferPool.release(std::move(output));
+    }
+    return *destination;
+}
+
+QImage ImageSplitter::cropView(const QImage& image, const QRect& rect)
+{
+    QRect bounded = rect.intersected(image.rect());
+    if (bounded.isEmpty()) {
+        return QImage();
+    }
     
-    // Calculate the crop rectangle in image coordinates
-    int cropX = static_cast<int>(monitor.geometry.x() * scaleX);
-    int cropY = static_cast<int>(monitor.geometry.y() * scaleY);
-    int cropWidth = static_cast<int>(monitor.geometry.width() * scaleX);
-    int cropHeight = static_cast<int>(monitor.geometry.height() * scaleY);
+    // Sub-byte formats cannot be addressed at arbitrary x offsets
+    if (image.depth() < 8) {
+        return image.copy(bounded);
+    }
     
-    return QRect(cropX, cropY, cropWidth, cropHeight);
+    // Non-owning, stride-aware view; it shares the source's rows and is only
+    // valid while the source is alive. Writing to it detaches a copy.
+    const uchar* origin = image.constBits()
+                          + qsizetype(bounded.y()) * image.bytesPerLine()
+                          + qsizetype(bounded.x()) * (image.depth() / 8);
+    QImage view(origin, bounded.width(), bounded.height(), image.bytesPerLine(), image.format());
+    if (image.format() == QImage::Format_Indexed8) {
+        view.setColorTable(image.colorTable());
+    }
+    return view;
+}
+
+void ImageSplitter::copySettingsFrom(const ImageSplitter& other)
+{
+    m_scaledDecodeEnabled = other.m_scaledDecodeEnabled;
+    m_regionDecodeEnabled = other.m_regionDecodeEnabled;
+    m_losslessCropEnabled = other.m_losslessCropEnabled;
+    m_memoryLimit = other.m_memoryLimit;
+    m_resampleFilter = other.m_resampleFilter;
+    m_outputFormat = other.m_outputFormat;
+    m_outputQuality = other.m_outputQuality;
+    m_jpegOptions = other.m_jpegOptions;
+    m_cacheLimit = other.m_cacheLimit;
+    m_decodedCacheLimit = other.m_decodedCacheLimit;
+    m_incrementalEnabled = other.m_incrementalEnabled;
+}
+
+QString ImageSplitter::decodedCacheDirectory(const QString& outputDir)
+{
+    return QDir(outputDir).filePath("decoded");
+}
+
+QString ImageSplitter::manifestDirectory(const QString& outputDir)
+{
+    return QDir(outputDir).filePath("manifests");
+}
+
+void ImageSplitter::setMemoryLimit(qint64 bytes)
+{
+    m_memoryLimit = qMax<qint64>(0, bytes);
+}
+
+void ImageSplitter::setThreadCount(int threads)
+{
+    m_threadCount = qMax(0, threads);
+}
+
+int ImageSplitter::effectiveThreadCount(int taskCount) const
+{
+    int threads = m_threadCount > 0 ? m_threadCount : QThread::idealThreadCount();
+    return qBound(1, threads, qMax(1, taskCount));
 }
 
 int ImageSplitter::getMonitorIndex(const MonitorInfo& monitor)
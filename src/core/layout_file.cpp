@@ -0,0 +1,138 @@
+#include "core/layout_file.h"
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <cstdio>
+
+namespace WallpaperCore {
+
+namespace {
+
+void setError(QString* error, const QString& message)
+{
+    if (error) {
+        *error = message;
+    }
+}
+
+} // namespace
+
+QJsonObject LayoutFile::monitorToJson(const MonitorInfo& monitor)
+{
+    QJsonObject geometry;
+    geometry.insert("x", monitor.geometry.x());
+    geometry.insert("y", monitor.geometry.y());
+    geometry.insert("width", monitor.geometry.width());
+    geometry.insert("height", monitor.geometry.height());
+
+    QJsonObject object;
+    object.insert("name", monitor.name);
+    object.insert("primary", monitor.isPrimary);
+    object.insert("geometry", geometry);
+    if (monitor.actualResolution.isValid()) {
+        QJsonObject resolution;
+        resolution.insert("width", monitor.actualResolution.width());
+        resolution.insert("height", monitor.actualResolution.height());
+        object.insert("resolution", resolution);
+    }
+    return object;
+}
+
+QByteArray LayoutFile::toJson(const MonitorList& monitors)
+{
+    QJsonArray array;
+    for (const auto& monitor : monitors) {
+        array.append(monitorToJson(monitor));
+    }
+
+    return QJsonDocument(array).toJson(QJsonDocument::Indented);
+}
+
+bool LayoutFile::fromJson(const QByteArray& json, MonitorList* monitors, QString* error)
+{
+    QJsonParseError parseError;
+    QJsonDocument document = QJsonDocument::fromJson(json, &parseError);
+    if (parseError.error != QJsonParseError::NoError) {
+        setError(error, QString("Invalid JSON at offset %1: %2")
+                 .arg(parseError.offset).arg(parseError.errorString()));
+        return false;
+    }
+    if (!document.isArray()) {
+        setError(error, "Expected a list of monitors");
+        return false;
+    }
+
+    MonitorList result;
+    const QJsonArray array = document.array();
+    for (int i = 0; i < array.size(); ++i) {
+        QJsonObject object = array[i].toObject();
+        QJsonObject geometry = object.value("geometry").toObject();
+        QRect rect(geometry.value("x").toInt(), geometry.value("y").toInt(),
+                   geometry.value("width").toInt(), geometry.value("height").toInt());
+        if (rect.isEmpty()) {
+            setError(error, QString("Monitor %1 has no valid geometry").arg(i));
+            return false;
+        }
+
+        QSize resolution = rect.size();
+        if (object.contains("resolution")) {
+            QJsonObject size = object.value("resolution").toObject();
+            resolution = QSize(size.value("width").toInt(), size.value("height").toInt());
+            if (resolution.isEmpty()) {
+                setError(error, QString("Monitor %1 has no valid resolution").arg(i));
+                return false;
+            }
+        }
+
+        QString name = object.value("name").toString();
+        if (name.isEmpty()) {
+            name = QString("monitor-%1").arg(i);
+        }
+        result.push_back(MonitorInfo(name, rect, resolution, object.value("primary").toBool()));
+    }
+
+    if (result.empty()) {
+        setError(error, "The layout has no monitors");
+        return false;
+    }
+
+    *monitors = result;
+    return true;
+}
+
+bool LayoutFile::load(const QString& path, MonitorList* monitors, QString* error)
+{
+    QFile file(path == "-" ? QString() : path);
+    bool opened = path == "-" ? file.open(stdin, QIODevice::ReadOnly)
+                              : file.open(QIODevice::ReadOnly);
+    if (!opened) {
+        setError(error, QString("Cannot read %1: %2").arg(path, file.errorString()));
+        return false;
+    }
+
+    return fromJson(file.readAll(), monitors, error);
+}
+
+bool LayoutFile::save(const QString& path, const MonitorList& monitors, QString* error)
+{
+    QByteArray json = toJson(monitors);
+    if (path == "-") {
+        QFile output;
+        if (!output.open(stdout, QIODevice::WriteOnly) || output.write(json) != json.size()) {
+            setError(error, QString("Cannot write to stdout: %1").arg(output.errorString()));
+            return false;
+        }
+        return true;
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size() || !file.commit()) {
+        setError(error, QString("Cannot write %1: %2").arg(path, file.errorString()));
+        return false;
+    }
+    return true;
+}
+
+} // namespace WallpaperCore
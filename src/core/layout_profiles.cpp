@@ -0,0 +1,176 @@
+#include "core/layout_profiles.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDebug>
+#include <QSettings>
+#include <algorithm>
+
+namespace WallpaperCore {
+
+MonitorList LayoutProfile::enabledMonitors() const
+{
+    MonitorList result;
+    for (size_t i = 0; i < monitors.size(); ++i) {
+        if (static_cast<int>(i) >= enabled.size() || enabled[static_cast<int>(i)]) {
+            result.push_back(monitors[i]);
+        }
+    }
+    return result;
+}
+
+LayoutProfileStore::LayoutProfileStore(const QString& configPath, int maxProfiles)
+    : m_configPath(configPath)
+    , m_maxProfiles(qMax(1, maxProfiles))
+{
+    load();
+}
+
+QString LayoutProfileStore::layoutKey(const MonitorList& monitors)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    for (const auto& monitor : sortedByPosition(monitors)) {
+        stream << monitor.geometry << monitor.actualResolution;
+    }
+
+    return QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Sha1)
+                               .toHex().left(16));
+}
+
+bool LayoutProfileStore::contains(const QString& key) const
+{
+    return std::any_of(m_profiles.cbegin(), m_profiles.cend(),
+                       [&key](const LayoutProfile& profile) { return profile.key == key; });
+}
+
+LayoutProfile LayoutProfileStore::profile(const QString& key) const
+{
+    for (const LayoutProfile& profile : m_profiles) {
+        if (profile.key == key) {
+            return profile;
+        }
+    }
+    return LayoutProfile();
+}
+
+QList<LayoutProfile> LayoutProfileStore::profiles() const
+{
+    return m_profiles;
+}
+
+QString LayoutProfileStore::remember(const MonitorList& monitors, const QVector<bool>& enabled)
+{
+    if (monitors.empty()) {
+        return QString();
+    }
+
+    LayoutProfile profile;
+    profile.key = layoutKey(monitors);
+    profile.monitors = monitors;
+    profile.enabled = enabled;
+    profile.enabled.resize(static_cast<int>(monitors.size()), true);
+    profile.lastSeen = QDateTime::currentDateTime();
+
+    // Most recently seen first; anything past the limit is forgotten
+    m_profiles.erase(std::remove_if(m_profiles.begin(), m_profiles.end(),
+                                    [&profile](const LayoutProfile& existing) {
+                                        return existing.key == profile.key;
+                                    }),
+                     m_profiles.end());
+    m_profiles.prepend(profile);
+    while (m_profiles.size() > m_maxProfiles) {
+        qDebug() << "Forgetting monitor layout" << m_profiles.last().key;
+        m_profiles.removeLast();
+    }
+
+    save();
+    return profile.key;
+}
+
+void LayoutProfileStore::remove(const QString& key)
+{
+    m_profiles.erase(std::remove_if(m_profiles.begin(), m_profiles.end(),
+                                    [&key](const LayoutProfile& profile) {
+                                        return profile.key == key;
+                                    }),
+                     m_profiles.end());
+    save();
+}
+
+void LayoutProfileStore::load()
+{
+    m_profiles.clear();
+    if (m_configPath.isEmpty()) {
+        return;
+    }
+
+    QSettings settings(m_configPath, QSettings::IniFormat);
+    int count = settings.beginReadArray("profiles");
+    for (int i = 0; i < count; ++i) {
+        settings.setArrayIndex(i);
+
+        LayoutProfile profile;
+        profile.lastSeen = settings.value("lastSeen").toDateTime();
+
+        int monitorCount = settings.beginReadArray("monitors");
+        for (int j = 0; j < monitorCount; ++j) {
+            settings.setArrayIndex(j);
+            MonitorInfo monitor(settings.value("name").toString(),
+                                settings.value("geometry").toRect(),
+                                settings.value("resolution").toSize(),
+                                settings.value("primary", false).toBool());
+            profile.monitors.push_back(monitor);
+            profile.enabled.append(settings.value("enabled", true).toBool());
+        }
+        settings.endArray();
+
+        // Keys are recomputed rather than trusted, so a change to
+        // layoutKey() can never match the wrong layout
+        if (!profile.monitors.empty()) {
+            profile.key = layoutKey(profile.monitors);
+            if (!contains(profile.key)) {
+                m_profiles.append(profile);
+            }
+        }
+    }
+    settings.endArray();
+
+    std::stable_sort(m_profiles.begin(), m_profiles.end(),
+                     [](const LayoutProfile& a, const LayoutProfile& b) {
+                         return a.lastSeen > b.lastSeen;
+                     });
+    while (m_profiles.size() > m_maxProfiles) {
+        m_profiles.removeLast();
+    }
+}
+
+void LayoutProfileStore::save() const
+{
+    if (m_configPath.isEmpty()) {
+        return;
+    }
+
+    QSettings settings(m_configPath, QSettings::IniFormat);
+    settings.remove("profiles");
+    settings.beginWriteArray("profiles", m_profiles.size());
+    for (int i = 0; i < m_profiles.size(); ++i) {
+        const LayoutProfile& profile = m_profiles[i];
+        settings.setArrayIndex(i);
+        settings.setValue("lastSeen", profile.lastSeen);
+
+        settings.beginWriteArray("monitors", static_cast<int>(profile.monitors.size()));
+        for (int j = 0; j < static_cast<int>(profile.monitors.size()); ++j) {
+            const MonitorInfo& monitor = profile.monitors[j];
+            settings.setArrayIndex(j);
+            settings.setValue("name", monitor.name);
+            settings.setValue("geometry", monitor.geometry);
+            settings.setValue("resolution", monitor.actualResolution);
+            settings.setValue("primary", monitor.isPrimary);
+            settings.setValue("enabled", j < profile.enabled.size() ? profile.enabled[j] : true);
+        }
+        settings.endArray();
+    }
+    settings.endArray();
+}
+
+} // namespace WallpaperCore
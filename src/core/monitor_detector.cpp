@@ -1,15 +1,52 @@
 #include "core/monitor_detector.h"
+#include "core/plasma_shell.h"
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
 #include <QDebug>
 #include <QDir>
 #include <QGuiApplication>
 #include <QScreen>
-#include <QProcess>
+#include <algorithm>
 
 namespace WallpaperCore {
 
+namespace {
+
+bool sameMonitors(const MonitorList& a, const MonitorList& b)
+{
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(),
+                      [](const MonitorInfo& x, const MonitorInfo& y) {
+                          return x.name == y.name && x.geometry == y.geometry &&
+                                 x.actualResolution == y.actualResolution &&
+                                 x.isPrimary == y.isPrimary;
+                      });
+}
+
+} // namespace
+
 MonitorDetector::MonitorDetector(QObject* parent)
     : QObject(parent)
+    , m_valid(false)
 {
+    m_settleTimer.setSingleShot(true);
+    m_settleTimer.setInterval(DefaultSettleDelay);
+    connect(&m_settleTimer, &QTimer::timeout, this, &MonitorDetector::updateMonitors);
+    
+    // Without a GUI application there are no screens to watch
+    QGuiApplication* app = qobject_cast<QGuiApplication*>(QCoreApplication::instance());
+    if (!app) {
+        return;
+    }
+    
+    connect(app, &QGuiApplication::screenAdded, this, [this](QScreen* screen) {
+        watchScreen(screen);
+        scheduleUpdate();
+    });
+    connect(app, &QGuiApplication::screenRemoved, this, &MonitorDetector::scheduleUpdate);
+    connect(app, &QGuiApplication::primaryScreenChanged, this, &MonitorDetector::scheduleUpdate);
+    for (QScreen* screen : app->screens()) {
+        watchScreen(screen);
+    }
 }
 
 MonitorInfo MonitorDetector::getPrimaryMonitor()
@@ -29,27 +66,38 @@ MonitorInfo MonitorDetector::getPrimaryMonitor()
 
 void MonitorDetector::refreshMonitors()
 {
-    m_monitors = detectMonitors();
+    m_settleTimer.stop();
+    m_monitors = readScreens();
+    m_valid = true;
+    queryPlasmaScreens();
     emit monitorsChanged();
 }
 
 MonitorList MonitorDetector::detectMonitors()
 {
-    MonitorList monitors;
-    
-    // Use KDE's native monitor detection via dbus
-    QProcess process;
-    process.start("qdbus", QStringList() << "org.kde.plasmashell" << "/PlasmaShell" 
-                 << "org.kde.PlasmaShell.evaluateScript" 
-                 << "JSON.stringify(desktops().filter(d => d.screen != -1).map(d => ({screen: d.screen, geom: screenGeometry(d.screen)})))");
-    
-    if (process.waitForFinished(5000) && process.exitCode() == 0) {
-        QString output = process.readAllStandardOutput();
-        // Parse and use KDE's monitor info
-        qDebug() << "KDE monitors:" << output;
+    // A change that is still settling is picked up now rather than later.
+    // It is still reported since the settle timer no longer will, but from
+    // the event loop, so no handler runs inside the caller of this getter.
+    if (!m_valid || m_settleTimer.isActive()) {
+        const bool wasValid = m_valid;
+        m_settleTimer.stop();
+        MonitorList monitors = readScreens();
+        const bool changed = wasValid && !sameMonitors(monitors, m_monitors);
+        m_monitors = monitors;
+        m_valid = true;
+        if (changed) {
+            qDebug() << "Monitors changed:" << m_monitors.size() << "connected";
+            queryPlasmaScreens();
+            QMetaObject::invokeMethod(this, &MonitorDetector::monitorsChanged, Qt::QueuedConnection);
+        }
     }
+    return m_monitors;
+}
+
+MonitorList MonitorDetector::readScreens() const
+{
+    MonitorList monitors;
     
-    // Fallback to Qt detection
     QGuiApplication* app = qobject_cast<QGuiApplication*>(QCoreApplication::instance());
     if (!app) {
         return monitors;
@@ -77,8 +125,45 @@ MonitorList MonitorDetector::detectMonitors()
         qDebug() << "Monitor:" << monitor.name << "at" << monitor.geometry;
     }
     
-    m_monitors = monitors;
     return monitors;
 }
 
-} // namespace WallpaperCore 
\ No newline at end of file
+void MonitorDetector::watchScreen(QScreen* screen)
+{
+    connect(screen, &QScreen::geometryChanged, this, &MonitorDetector::scheduleUpdate);
+}
+
+void MonitorDetector::scheduleUpdate()
+{
+    m_settleTimer.start();
+}
+
+void MonitorDetector::updateMonitors()
+{
+    MonitorList monitors = readScreens();
+    if (m_valid && sameMonitors(monitors, m_monitors)) {
+        return;
+    }
+    
+    m_monitors = monitors;
+    m_valid = true;
+    qDebug() << "Monitors changed:" << m_monitors.size() << "connected";
+    queryPlasmaScreens();
+    emit monitorsChanged();
+}
+
+void MonitorDetector::queryPlasmaScreens()
+{
+    QDBusPendingCallWatcher* watcher = new QDBusPendingCallWatcher(PlasmaShell::evaluateScript(
+        "print(JSON.stringify(desktops().filter(d => d.screen != -1).map(d => ({screen: d.screen, geom: screenGeometry(d.screen)}))))",
+        5000), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [](QDBusPendingCallWatcher* call) {
+        QDBusPendingReply<QString> reply = *call;
+        if (reply.isValid()) {
+            qDebug() << "KDE monitors:" << reply.value();
+        }
+        call->deleteLater();
+    });
+}
+
+} // namespace WallpaperCore
@@ -0,0 +1,70 @@
+#include "core/plasma_shell.h"
+#include <QDBusConnection>
+#include <QDBusConnectionInterface>
+#include <QDBusMessage>
+#include <QDebug>
+#include <QProcess>
+#include <QStandardPaths>
+#include <QStringList>
+
+namespace WallpaperCore {
+namespace PlasmaShell {
+
+namespace {
+
+const char* const Service = "org.kde.plasmashell";
+const char* const Path = "/PlasmaShell";
+const char* const Interface = "org.kde.PlasmaShell";
+
+} // namespace
+
+bool isAvailable()
+{
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    return bus.isConnected() && bus.interface() &&
+           bus.interface()->isServiceRegistered(Service).value();
+}
+
+QDBusPendingCall evaluateScript(const QString& script, int timeoutMs)
+{
+    // A plain method call rather than a QDBusInterface: nothing is
+    // introspected, and it keeps working across plasmashell restarts
+    QDBusMessage message = QDBusMessage::createMethodCall(Service, Path, Interface, "evaluateScript");
+    message << script;
+    return QDBusConnection::sessionBus().asyncCall(message, timeoutMs);
+}
+
+bool evaluateScriptWithTool(const QString& script, int timeoutMs, QString* output)
+{
+    // Qt 6 distributions install the tool as qdbus6, older ones as qdbus
+    QString tool = QStandardPaths::findExecutable("qdbus6");
+    if (tool.isEmpty()) {
+        tool = QStandardPaths::findExecutable("qdbus");
+    }
+    if (tool.isEmpty()) {
+        qWarning() << "Neither qdbus6 nor qdbus was found";
+        return false;
+    }
+
+    QProcess process;
+    process.start(tool, QStringList() << Service << Path
+                  << QString("%1.evaluateScript").arg(Interface) << script);
+    if (!process.waitForFinished(timeoutMs)) {
+        qWarning() << "Timeout running" << tool;
+        process.kill();
+        process.waitForFinished();
+        return false;
+    }
+    if (process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0) {
+        qWarning() << tool << "failed:" << QString::fromUtf8(process.readAllStandardError());
+        return false;
+    }
+
+    if (output) {
+        *output = QString::fromUtf8(process.readAllStandardOutput());
+    }
+    return true;
+}
+
+} // namespace PlasmaShell
+} // namespace WallpaperCore
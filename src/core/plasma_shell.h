@@ -0,0 +1,27 @@
+#pragma once
+
+// Internal access to plasmashell's scripting interface
+// (org.kde.PlasmaShell.evaluateScript on the session bus).
+
+#include <QDBusPendingCall>
+#include <QString>
+
+namespace WallpaperCore {
+namespace PlasmaShell {
+
+// Whether plasmashell is registered on the session bus
+bool isAvailable();
+
+// Run a desktop script without blocking. The call goes over the process's
+// shared session bus connection, so no process is started and no
+// connection is set up per call. The reply carries the script's print()
+// output as a string.
+QDBusPendingCall evaluateScript(const QString& script, int timeoutMs);
+
+// Run a desktop script by starting the qdbus tool (qdbus6 or qdbus) and
+// wait for it, the way scripts were run before. Only kept to measure the
+// native call against it.
+bool evaluateScriptWithTool(const QString& script, int timeoutMs, QString* output = nullptr);
+
+} // namespace PlasmaShell
+} // namespace WallpaperCore
@@ -0,0 +1,150 @@
+#include "core/resample_kernels.h"
+#include <cstring>
+#include <immintrin.h>
+
+// Compiled with -mavx2; only called after runtime CPU detection
+
+namespace WallpaperCore {
+namespace ResampleKernels {
+
+namespace {
+
+// Two 16-bit coefficients packed for _mm(256)_madd_epi16
+inline int32_t coefficientPair(int16_t first, int16_t second)
+{
+    return static_cast<int32_t>(static_cast<uint16_t>(first)
+                                | (static_cast<uint32_t>(static_cast<uint16_t>(second)) << 16));
+}
+
+inline __m128i narrowToBytes(__m256i sums)
+{
+    sums = _mm256_srai_epi32(sums, CoefficientBits);
+    return _mm_packs_epi32(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+}
+
+} // namespace
+
+void horizontalAvx2(const uint8_t* src, std::ptrdiff_t srcStride,
+                    uint8_t* dst, std::ptrdiff_t dstStride,
+                    int rows, const FilterTable& table)
+{
+    // Interleave the channels of pixel pairs (0,1) and (2,3)
+    const __m128i quadShuffle = _mm_setr_epi8(0, 4, 1, 5, 2, 6, 3, 7,
+                                              8, 12, 9, 13, 10, 14, 11, 15);
+    const __m128i pairShuffle = _mm_setr_epi8(0, 4, 1, 5, 2, 6, 3, 7,
+                                              -1, -1, -1, -1, -1, -1, -1, -1);
+
+    for (int y = 0; y < rows; ++y) {
+        const uint8_t* srcRow = src + y * srcStride;
+        uint8_t* dstRow = dst + y * dstStride;
+
+        for (int x = 0; x < table.dstLength; ++x) {
+            const uint8_t* pixel = srcRow + table.first[x] * 4;
+            const int16_t* coefficients = &table.coefficients[static_cast<size_t>(x) * table.stride];
+            const int count = table.count[x];
+
+            // Four taps per step: the low lane blends taps k, k+1 and the
+            // high lane taps k+2, k+3
+            __m256i wideSums = _mm256_setzero_si256();
+            int k = 0;
+            for (; k + 4 <= count; k += 4) {
+                __m128i quad = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixel + k * 4));
+                __m256i pixels = _mm256_cvtepu8_epi16(_mm_shuffle_epi8(quad, quadShuffle));
+                __m256i weights = _mm256_setr_epi32(
+                    coefficientPair(coefficients[k], coefficients[k + 1]),
+                    coefficientPair(coefficients[k], coefficients[k + 1]),
+                    coefficientPair(coefficients[k], coefficients[k + 1]),
+                    coefficientPair(coefficients[k], coefficients[k + 1]),
+                    coefficientPair(coefficients[k + 2], coefficients[k + 3]),
+                    coefficientPair(coefficients[k + 2], coefficients[k + 3]),
+                    coefficientPair(coefficients[k + 2], coefficients[k + 3]),
+                    coefficientPair(coefficients[k + 2], coefficients[k + 3]));
+                wideSums = _mm256_add_epi32(wideSums, _mm256_madd_epi16(pixels, weights));
+            }
+
+            __m128i sums = _mm_add_epi32(_mm256_castsi256_si128(wideSums),
+                                         _mm256_extracti128_si256(wideSums, 1));
+            sums = _mm_add_epi32(sums, _mm_set1_epi32(RoundingBias));
+
+            for (; k + 2 <= count; k += 2) {
+                __m128i pair = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pixel + k * 4));
+                pair = _mm_cvtepu8_epi16(_mm_shuffle_epi8(pair, pairShuffle));
+                __m128i weights = _mm_set1_epi32(coefficientPair(coefficients[k], coefficients[k + 1]));
+                sums = _mm_add_epi32(sums, _mm_madd_epi16(pair, weights));
+            }
+            if (k < count) {
+                int32_t value;
+                memcpy(&value, pixel + k * 4, sizeof(value));
+                __m128i single = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(value));
+                __m128i weights = _mm_set1_epi32(coefficientPair(coefficients[k], 0));
+                sums = _mm_add_epi32(sums, _mm_madd_epi16(single, weights));
+            }
+
+            __m128i packed = _mm_srai_epi32(sums, CoefficientBits);
+            packed = _mm_packs_epi32(packed, packed);
+            packed = _mm_packus_epi16(packed, packed);
+            int32_t result = _mm_cvtsi128_si32(packed);
+            memcpy(dstRow + x * 4, &result, sizeof(result));
+        }
+    }
+}
+
+void verticalAvx2(const uint8_t* src, std::ptrdiff_t srcStride, int srcOffset,
+                  uint8_t* dst, std::ptrdiff_t dstStride,
+                  int dstBegin, int dstEnd, int rowBytes,
+                  const FilterTable& table, bool premultiplied)
+{
+    const __m128i zero = _mm_setzero_si128();
+    // Alpha of each of the pixels broadcast to all of its bytes
+    const __m128i alphaShuffle = _mm_setr_epi8(3, 3, 3, 3, 7, 7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15);
+
+    for (int y = dstBegin; y < dstEnd; ++y) {
+        const uint8_t* firstRow = src + (table.first[y] - srcOffset) * srcStride;
+        const int16_t* coefficients = &table.coefficients[static_cast<size_t>(y) * table.stride];
+        const int count = table.count[y];
+        uint8_t* dstRow = dst + (y - dstBegin) * dstStride;
+
+        // Sixteen bytes per step, two rows blended per madd
+        int x = 0;
+        for (; x + 16 <= rowBytes; x += 16) {
+            __m256i low = _mm256_set1_epi32(RoundingBias);
+            __m256i high = _mm256_set1_epi32(RoundingBias);
+
+            int k = 0;
+            for (; k + 2 <= count; k += 2) {
+                __m128i row0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(firstRow + k * srcStride + x));
+                __m128i row1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(firstRow + (k + 1) * srcStride + x));
+                __m256i weights = _mm256_set1_epi32(coefficientPair(coefficients[k], coefficients[k + 1]));
+                low = _mm256_add_epi32(low, _mm256_madd_epi16(_mm256_cvtepu8_epi16(_mm_unpacklo_epi8(row0, row1)), weights));
+                high = _mm256_add_epi32(high, _mm256_madd_epi16(_mm256_cvtepu8_epi16(_mm_unpackhi_epi8(row0, row1)), weights));
+            }
+            if (k < count) {
+                __m128i row0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(firstRow + k * srcStride + x));
+                __m256i weights = _mm256_set1_epi32(coefficientPair(coefficients[k], 0));
+                low = _mm256_add_epi32(low, _mm256_madd_epi16(_mm256_cvtepu8_epi16(_mm_unpacklo_epi8(row0, zero)), weights));
+                high = _mm256_add_epi32(high, _mm256_madd_epi16(_mm256_cvtepu8_epi16(_mm_unpackhi_epi8(row0, zero)), weights));
+            }
+
+            __m128i bytes = _mm_packus_epi16(narrowToBytes(low), narrowToBytes(high));
+            if (premultiplied) {
+                bytes = _mm_min_epu8(bytes, _mm_shuffle_epi8(bytes, alphaShuffle));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dstRow + x), bytes);
+        }
+
+        const int tail = x;
+        for (; x < rowBytes; ++x) {
+            int32_t value = RoundingBias;
+            for (int k = 0; k < count; ++k) {
+                value += firstRow[k * srcStride + x] * static_cast<int32_t>(coefficients[k]);
+            }
+            dstRow[x] = clampToByte(value);
+        }
+        if (premultiplied) {
+            clampToAlpha(dstRow + tail, (rowBytes - tail) / 4);
+        }
+    }
+}
+
+} // namespace ResampleKernels
+} // namespace WallpaperCore
\ No newline at end of file
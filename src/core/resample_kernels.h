@@ -0,0 +1,103 @@
+#pragma once
+
+// Internal separable resampling kernels. Kept free of Qt so the
+// instruction-set specific translation units can be compiled with their
+// own target flags.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace WallpaperCore {
+namespace ResampleKernels {
+
+// Coefficients are signed 2.14 fixed point
+constexpr int CoefficientBits = 14;
+constexpr int32_t RoundingBias = 1 << (CoefficientBits - 1);
+
+enum class FilterKind { Box, Bilinear, Lanczos3 };
+
+// Filter weights mapping one axis of srcLength samples onto dstLength
+// samples. Output i reads count[i] consecutive inputs starting at first[i]
+// with weights coefficients[i * stride .. i * stride + count[i]).
+struct FilterTable {
+    int srcLength = 0;
+    int dstLength = 0;
+    int stride = 0;
+    std::vector<int32_t> first;
+    std::vector<int32_t> count;
+    std::vector<int16_t> coefficients;
+};
+
+FilterTable buildFilterTable(int srcLength, int dstLength, FilterKind filter);
+
+// Horizontal pass over rows of 4-byte pixels: every row of src (srcWidth ==
+// table.srcLength pixels) becomes a row of table.dstLength pixels in dst
+using HorizontalKernel = void (*)(const uint8_t* src, std::ptrdiff_t srcStride,
+                                  uint8_t* dst, std::ptrdiff_t dstStride,
+                                  int rows, const FilterTable& table);
+
+// Vertical pass producing output rows [dstBegin, dstEnd): output row y
+// blends table.count[y] rows of src starting at table.first[y] - srcOffset,
+// each rowBytes long. For premultiplied pixels the colour bytes of every
+// output pixel are clamped to its alpha, since negative lobes can push
+// them above it.
+using VerticalKernel = void (*)(const uint8_t* src, std::ptrdiff_t srcStride, int srcOffset,
+                                uint8_t* dst, std::ptrdiff_t dstStride,
+                                int dstBegin, int dstEnd, int rowBytes,
+                                const FilterTable& table, bool premultiplied);
+
+void horizontalScalar(const uint8_t* src, std::ptrdiff_t srcStride,
+                      uint8_t* dst, std::ptrdiff_t dstStride,
+                      int rows, const FilterTable& table);
+void verticalScalar(const uint8_t* src, std::ptrdiff_t srcStride, int srcOffset,
+                    uint8_t* dst, std::ptrdiff_t dstStride,
+                    int dstBegin, int dstEnd, int rowBytes,
+                    const FilterTable& table, bool premultiplied);
+
+#ifdef WALLPAPER_HAVE_X86_KERNELS
+void horizontalSse41(const uint8_t* src, std::ptrdiff_t srcStride,
+                     uint8_t* dst, std::ptrdiff_t dstStride,
+                     int rows, const FilterTable& table);
+void verticalSse41(const uint8_t* src, std::ptrdiff_t srcStride, int srcOffset,
+                   uint8_t* dst, std::ptrdiff_t dstStride,
+                   int dstBegin, int dstEnd, int rowBytes,
+                   const FilterTable& table, bool premultiplied);
+void horizontalAvx2(const uint8_t* src, std::ptrdiff_t srcStride,
+                    uint8_t* dst, std::ptrdiff_t dstStride,
+                    int rows, const FilterTable& table);
+void verticalAvx2(const uint8_t* src, std::ptrdiff_t srcStride, int srcOffset,
+                  uint8_t* dst, std::ptrdiff_t dstStride,
+                  int dstBegin, int dstEnd, int rowBytes,
+                  const FilterTable& table, bool premultiplied);
+#endif
+
+inline uint8_t clampToByte(int32_t value)
+{
+    value >>= CoefficientBits;
+    return static_cast<uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+// Byte of a 32-bit ARGB pixel in memory that holds alpha
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+constexpr int AlphaByte = 0;
+#else
+constexpr int AlphaByte = 3;
+#endif
+
+// Clamp the colour bytes of count premultiplied pixels to their alpha
+inline void clampToAlpha(uint8_t* pixels, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        uint8_t* pixel = pixels + i * 4;
+        const uint8_t alpha = pixel[AlphaByte];
+        for (int c = 0; c < 4; ++c) {
+            if (pixel[c] > alpha) {
+                pixel[c] = alpha;
+            }
+        }
+    }
+}
+
+} // namespace ResampleKernels
+} // namespace WallpaperCore
\ No newline at end of file
@@ -0,0 +1,166 @@
+#include "core/resample_kernels.h"
+#include <algorithm>
+#include <cmath>
+
+namespace WallpaperCore {
+namespace ResampleKernels {
+
+namespace {
+
+constexpr double Pi = 3.14159265358979323846;
+
+double sinc(double x)
+{
+    if (x == 0.0) {
+        return 1.0;
+    }
+    x *= Pi;
+    return std::sin(x) / x;
+}
+
+double filterSupport(FilterKind filter)
+{
+    switch (filter) {
+    case FilterKind::Box:
+        return 0.5;
+    case FilterKind::Bilinear:
+        return 1.0;
+    case FilterKind::Lanczos3:
+        return 3.0;
+    }
+    return 1.0;
+}
+
+double filterWeight(FilterKind filter, double x)
+{
+    switch (filter) {
+    case FilterKind::Box:
+        return (x >= -0.5 && x < 0.5) ? 1.0 : 0.0;
+    case FilterKind::Bilinear:
+        x = std::fabs(x);
+        return x < 1.0 ? 1.0 - x : 0.0;
+    case FilterKind::Lanczos3:
+        return (x > -3.0 && x < 3.0) ? sinc(x) * sinc(x / 3.0) : 0.0;
+    }
+    return 0.0;
+}
+
+} // namespace
+
+FilterTable buildFilterTable(int srcLength, int dstLength, FilterKind filter)
+{
+    FilterTable table;
+    table.srcLength = srcLength;
+    table.dstLength = dstLength;
+    if (srcLength <= 0 || dstLength <= 0) {
+        return table;
+    }
+
+    // When shrinking, stretch the filter over the source footprint of one
+    // output sample so every input contributes (area averaging for Box)
+    const double scale = static_cast<double>(srcLength) / dstLength;
+    const double filterScale = std::max(scale, 1.0);
+    const double support = filterSupport(filter) * filterScale;
+
+    table.stride = static_cast<int>(std::ceil(support)) * 2 + 1;
+    table.first.resize(dstLength);
+    table.count.resize(dstLength);
+    table.coefficients.assign(static_cast<size_t>(dstLength) * table.stride, 0);
+
+    std::vector<double> weights(table.stride);
+    for (int i = 0; i < dstLength; ++i) {
+        const double center = (i + 0.5) * scale;
+        int first = std::max(static_cast<int>(center - support + 0.5), 0);
+        int last = std::min(static_cast<int>(center + support + 0.5), srcLength);
+        int count = std::min(last - first, table.stride);
+
+        double total = 0.0;
+        for (int k = 0; k < count; ++k) {
+            weights[k] = filterWeight(filter, (first + k - center + 0.5) / filterScale);
+            total += weights[k];
+        }
+
+        // Degenerate footprint (can happen for Box at exact half-pixel
+        // centres): fall back to the nearest input sample
+        if (count <= 0 || total == 0.0) {
+            first = std::min(static_cast<int>(center), srcLength - 1);
+            count = 1;
+            weights[0] = 1.0;
+            total = 1.0;
+        }
+
+        // Quantise and push the rounding error into the largest weight so
+        // every row sums to exactly 1.0 and flat areas stay flat
+        int16_t* coefficients = &table.coefficients[static_cast<size_t>(i) * table.stride];
+        int32_t sum = 0;
+        int largest = 0;
+        for (int k = 0; k < count; ++k) {
+            coefficients[k] = static_cast<int16_t>(std::lround(weights[k] / total * (1 << CoefficientBits)));
+            sum += coefficients[k];
+            if (std::abs(coefficients[k]) > std::abs(coefficients[largest])) {
+                largest = k;
+            }
+        }
+        coefficients[largest] = static_cast<int16_t>(coefficients[largest] + ((1 << CoefficientBits) - sum));
+
+        table.first[i] = first;
+        table.count[i] = count;
+    }
+
+    return table;
+}
+
+void horizontalScalar(const uint8_t* src, std::ptrdiff_t srcStride,
+                      uint8_t* dst, std::ptrdiff_t dstStride,
+                      int rows, const FilterTable& table)
+{
+    for (int y = 0; y < rows; ++y) {
+        const uint8_t* srcRow = src + y * srcStride;
+        uint8_t* dstRow = dst + y * dstStride;
+
+        for (int x = 0; x < table.dstLength; ++x) {
+            const uint8_t* pixel = srcRow + table.first[x] * 4;
+            const int16_t* coefficients = &table.coefficients[static_cast<size_t>(x) * table.stride];
+
+            int32_t c0 = RoundingBias, c1 = RoundingBias, c2 = RoundingBias, c3 = RoundingBias;
+            for (int k = 0; k < table.count[x]; ++k) {
+                const int32_t weight = coefficients[k];
+                c0 += pixel[k * 4 + 0] * weight;
+                c1 += pixel[k * 4 + 1] * weight;
+                c2 += pixel[k * 4 + 2] * weight;
+                c3 += pixel[k * 4 + 3] * weight;
+            }
+
+            dstRow[x * 4 + 0] = clampToByte(c0);
+            dstRow[x * 4 + 1] = clampToByte(c1);
+            dstRow[x * 4 + 2] = clampToByte(c2);
+            dstRow[x * 4 + 3] = clampToByte(c3);
+        }
+    }
+}
+
+void verticalScalar(const uint8_t* src, std::ptrdiff_t srcStride, int srcOffset,
+                    uint8_t* dst, std::ptrdiff_t dstStride,
+                    int dstBegin, int dstEnd, int rowBytes,
+                    const FilterTable& table, bool premultiplied)
+{
+    for (int y = dstBegin; y < dstEnd; ++y) {
+        const uint8_t* firstRow = src + (table.first[y] - srcOffset) * srcStride;
+        const int16_t* coefficients = &table.coefficients[static_cast<size_t>(y) * table.stride];
+        uint8_t* dstRow = dst + (y - dstBegin) * dstStride;
+
+        for (int x = 0; x < rowBytes; ++x) {
+            int32_t value = RoundingBias;
+            for (int k = 0; k < table.count[y]; ++k) {
+                value += firstRow[k * srcStride + x] * static_cast<int32_t>(coefficients[k]);
+            }
+            dstRow[x] = clampToByte(value);
+        }
+        if (premultiplied) {
+            clampToAlpha(dstRow, rowBytes / 4);
+        }
+    }
+}
+
+} // namespace ResampleKernels
+} // namespace WallpaperCore
\ No newline at end of file
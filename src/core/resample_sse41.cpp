@@ -0,0 +1,136 @@
+#include "core/resample_kernels.h"
+#include <cstring>
+#include <smmintrin.h>
+
+// Compiled with -msse4.1; only called after runtime CPU detection
+
+namespace WallpaperCore {
+namespace ResampleKernels {
+
+namespace {
+
+// Two 16-bit coefficients packed for _mm_madd_epi16
+inline int32_t coefficientPair(int16_t first, int16_t second)
+{
+    return static_cast<int32_t>(static_cast<uint16_t>(first)
+                                | (static_cast<uint32_t>(static_cast<uint16_t>(second)) << 16));
+}
+
+inline __m128i loadPixel(const uint8_t* pixel)
+{
+    int32_t value;
+    memcpy(&value, pixel, sizeof(value));
+    return _mm_cvtsi32_si128(value);
+}
+
+inline void storePixel(uint8_t* pixel, __m128i sums)
+{
+    __m128i packed = _mm_srai_epi32(sums, CoefficientBits);
+    packed = _mm_packs_epi32(packed, packed);
+    packed = _mm_packus_epi16(packed, packed);
+    int32_t value = _mm_cvtsi128_si32(packed);
+    memcpy(pixel, &value, sizeof(value));
+}
+
+} // namespace
+
+void horizontalSse41(const uint8_t* src, std::ptrdiff_t srcStride,
+                     uint8_t* dst, std::ptrdiff_t dstStride,
+                     int rows, const FilterTable& table)
+{
+    // Interleave the channels of two pixels: b0 b4 b1 b5 b2 b6 b3 b7
+    const __m128i pairShuffle = _mm_setr_epi8(0, 4, 1, 5, 2, 6, 3, 7,
+                                              -1, -1, -1, -1, -1, -1, -1, -1);
+
+    for (int y = 0; y < rows; ++y) {
+        const uint8_t* srcRow = src + y * srcStride;
+        uint8_t* dstRow = dst + y * dstStride;
+
+        for (int x = 0; x < table.dstLength; ++x) {
+            const uint8_t* pixel = srcRow + table.first[x] * 4;
+            const int16_t* coefficients = &table.coefficients[static_cast<size_t>(x) * table.stride];
+            const int count = table.count[x];
+
+            __m128i sums = _mm_set1_epi32(RoundingBias);
+            int k = 0;
+            for (; k + 2 <= count; k += 2) {
+                __m128i pair = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pixel + k * 4));
+                pair = _mm_cvtepu8_epi16(_mm_shuffle_epi8(pair, pairShuffle));
+                __m128i weights = _mm_set1_epi32(coefficientPair(coefficients[k], coefficients[k + 1]));
+                sums = _mm_add_epi32(sums, _mm_madd_epi16(pair, weights));
+            }
+            if (k < count) {
+                __m128i single = _mm_cvtepu8_epi32(loadPixel(pixel + k * 4));
+                __m128i weights = _mm_set1_epi32(coefficientPair(coefficients[k], 0));
+                sums = _mm_add_epi32(sums, _mm_madd_epi16(single, weights));
+            }
+
+            storePixel(dstRow + x * 4, sums);
+        }
+    }
+}
+
+void verticalSse41(const uint8_t* src, std::ptrdiff_t srcStride, int srcOffset,
+                   uint8_t* dst, std::ptrdiff_t dstStride,
+                   int dstBegin, int dstEnd, int rowBytes,
+                   const FilterTable& table, bool premultiplied)
+{
+    const __m128i zero = _mm_setzero_si128();
+    // Alpha of each of the pixels broadcast to all of its bytes
+    const __m128i alphaShuffle = _mm_setr_epi8(3, 3, 3, 3, 7, 7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15);
+
+    for (int y = dstBegin; y < dstEnd; ++y) {
+        const uint8_t* firstRow = src + (table.first[y] - srcOffset) * srcStride;
+        const int16_t* coefficients = &table.coefficients[static_cast<size_t>(y) * table.stride];
+        const int count = table.count[y];
+        uint8_t* dstRow = dst + (y - dstBegin) * dstStride;
+
+        // Eight bytes per step: rows are interleaved byte-wise so one madd
+        // blends two rows for four bytes at once
+        int x = 0;
+        for (; x + 8 <= rowBytes; x += 8) {
+            __m128i low = _mm_set1_epi32(RoundingBias);
+            __m128i high = _mm_set1_epi32(RoundingBias);
+
+            int k = 0;
+            for (; k + 2 <= count; k += 2) {
+                __m128i row0 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(firstRow + k * srcStride + x));
+                __m128i row1 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(firstRow + (k + 1) * srcStride + x));
+                __m128i interleaved = _mm_unpacklo_epi8(row0, row1);
+                __m128i weights = _mm_set1_epi32(coefficientPair(coefficients[k], coefficients[k + 1]));
+                low = _mm_add_epi32(low, _mm_madd_epi16(_mm_cvtepu8_epi16(interleaved), weights));
+                high = _mm_add_epi32(high, _mm_madd_epi16(_mm_cvtepu8_epi16(_mm_srli_si128(interleaved, 8)), weights));
+            }
+            if (k < count) {
+                __m128i row0 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(firstRow + k * srcStride + x));
+                __m128i interleaved = _mm_unpacklo_epi8(row0, zero);
+                __m128i weights = _mm_set1_epi32(coefficientPair(coefficients[k], 0));
+                low = _mm_add_epi32(low, _mm_madd_epi16(_mm_cvtepu8_epi16(interleaved), weights));
+                high = _mm_add_epi32(high, _mm_madd_epi16(_mm_cvtepu8_epi16(_mm_srli_si128(interleaved, 8)), weights));
+            }
+
+            __m128i packed = _mm_packs_epi32(_mm_srai_epi32(low, CoefficientBits),
+                                             _mm_srai_epi32(high, CoefficientBits));
+            __m128i bytes = _mm_packus_epi16(packed, packed);
+            if (premultiplied) {
+                bytes = _mm_min_epu8(bytes, _mm_shuffle_epi8(bytes, alphaShuffle));
+            }
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dstRow + x), bytes);
+        }
+
+        const int tail = x;
+        for (; x < rowBytes; ++x) {
+            int32_t value = RoundingBias;
+            for (int k = 0; k < count; ++k) {
+                value += firstRow[k * srcStride + x] * static_cast<int32_t>(coefficients[k]);
+            }
+            dstRow[x] = clampToByte(value);
+        }
+        if (premultiplied) {
+            clampToAlpha(dstRow + tail, (rowBytes - tail) / 4);
+        }
+    }
+}
+
+} // namespace ResampleKernels
+} // namespace WallpaperCore
\ No newline at end of file
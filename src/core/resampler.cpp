@@ -0,0 +1,277 @@
+#include "core/resampler.h"
+#include "core/image_buffer_pool.h"
+#include "core/resample_kernels.h"
+#include <QDebug>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <memory>
+
+namespace WallpaperCore {
+
+namespace {
+
+using ResampleKernels::FilterKind;
+using ResampleKernels::FilterTable;
+
+constexpr int MaxCachedTables = 64;
+constexpr qint64 MaxPooledIntermediateBytes = qint64(64) << 20;
+
+QMutex s_tableMutex;
+QHash<quint64, std::shared_ptr<const FilterTable>> s_tables;
+
+// Horizontal pass output, recycled across calls. Every byte is written
+// before it is read, so buffers are never cleared.
+ImageBufferPool& intermediatePool()
+{
+    static ImageBufferPool pool(MaxPooledIntermediateBytes);
+    return pool;
+}
+
+FilterKind filterKind(ResampleFilter filter)
+{
+    switch (filter) {
+    case ResampleFilter::Box:
+        return FilterKind::Box;
+    case ResampleFilter::Lanczos3:
+        return FilterKind::Lanczos3;
+    case ResampleFilter::Bilinear:
+    case ResampleFilter::QtSmooth:
+        break;
+    }
+    return FilterKind::Bilinear;
+}
+
+std::shared_ptr<const FilterTable> filterTable(int srcLength, int dstLength, FilterKind filter)
+{
+    quint64 key = (quint64(srcLength) << 34) | (quint64(dstLength) << 4) | quint64(filter);
+
+    QMutexLocker locker(&s_tableMutex);
+    auto it = s_tables.constFind(key);
+    if (it != s_tables.constEnd()) {
+        return it.value();
+    }
+
+    if (s_tables.size() >= MaxCachedTables) {
+        s_tables.clear();
+    }
+
+    auto table = std::make_shared<const FilterTable>(
+        ResampleKernels::buildFilterTable(srcLength, dstLength, filter));
+    s_tables.insert(key, table);
+    return table;
+}
+
+} // namespace
+
+Resampler::Isa Resampler::detectIsa()
+{
+#ifdef WALLPAPER_HAVE_X86_KERNELS
+    static const Isa isa = []() {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return Isa::AVX2;
+        }
+        if (__builtin_cpu_supports("sse4.1")) {
+            return Isa::SSE41;
+        }
+        return Isa::Scalar;
+    }();
+    return isa;
+#else
+    return Isa::Scalar;
+#endif
+}
+
+QString Resampler::isaName(Isa isa)
+{
+    switch (isa) {
+    case Isa::Auto:
+        return isaName(detectIsa());
+    case Isa::Scalar:
+        return "scalar";
+    case Isa::SSE41:
+        return "sse4.1";
+    case Isa::AVX2:
+        return "avx2";
+    }
+    return QString();
+}
+
+QImage Resampler::scaled(const QImage& image, const QSize& size,
+                         ResampleFilter filter, Isa isa, bool premultiplied)
+{
+    if (image.isNull() || size.isEmpty()) {
+        return QImage();
+    }
+
+    if (filter == ResampleFilter::QtSmooth) {
+        return image.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+
+    if (image.size() == size) {
+        return image;
+    }
+
+    QImage result(size, resampleFormat(image));
+    if (result.isNull()) {
+        qWarning() << "Failed to allocate resampled image of size" << size;
+        return QImage();
+    }
+
+    if (!scaleInto(image, result, filter, isa)) {
+        return QImage();
+    }
+
+    return result;
+}
+
+bool Resampler::scaleInto(const QImage& image, QImage& destination,
+                          ResampleFilter filter, Isa isa, bool premultiplied)
+{
+    if (image.isNull() || destination.isNull() || filter == ResampleFilter::QtSmooth) {
+        return false;
+    }
+
+    QImage::Format format = destination.format();
+    if (format != QImage::Format_RGB32 && format != QImage::Format_ARGB32_Premultiplied) {
+        qWarning() << "Unsupported resample destination format" << format;
+        return false;
+    }
+
+    // Views in the right format are read in place; anything else is
+    // converted once
+    QImage source = image.format() == format ? image : image.convertToFormat(format);
+
+    return resample(source.constBits(), source.width(), source.height(), source.bytesPerLine(),
+                    destination.bits(), destination.width(), destination.height(),
+                    destination.bytesPerLine(), filter, isa,
+                    format == QImage::Format_ARGB32_Premultiplied);
+}
+
+QImage::Format Resampler::resampleFormat(const QImage& image)
+{
+    return image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied
+                                   : QImage::Format_RGB32;
+}
+
+bool Resampler::resample(const uchar* src, int srcWidth, int srcHeight, qsizetype srcStride,
+                         uchar* dst, int dstWidth, int dstHeight, qsizetype dstStride,
+                         ResampleFilter filter, Isa isa, bool premultiplied)
+{
+    return resampleRows(src, srcWidth, srcHeight, 0, srcStride,
+                        dst, dstWidth, dstHeight, 0, dstHeight, dstStride, filter, isa, premultiplied);
+}
+
+bool Resampler::resampleRows(const uchar* src, int srcWidth, int srcHeight, int srcTop, qsizetype srcStride,
+                             uchar* dst, int dstWidth, int dstHeight, int dstBegin, int dstEnd,
+                             qsizetype dstStride, ResampleFilter filter, Isa isa, bool premultiplied)
+{
+    if (!src || !dst || filter == ResampleFilter::QtSmooth ||
+        srcWidth <= 0 || srcHeight <= 0 || dstWidth <= 0 || dstHeight <= 0 ||
+        dstBegin < 0 || dstEnd > dstHeight || dstBegin >= dstEnd || srcTop < 0) {
+        return false;
+    }
+
+    if (isa == Isa::Auto) {
+        isa = detectIsa();
+    }
+
+    ResampleKernels::HorizontalKernel horizontal = ResampleKernels::horizontalScalar;
+    ResampleKernels::VerticalKernel vertical = ResampleKernels::verticalScalar;
+#ifdef WALLPAPER_HAVE_X86_KERNELS
+    if (isa == Isa::AVX2) {
+        horizontal = ResampleKernels::horizontalAvx2;
+        vertical = ResampleKernels::verticalAvx2;
+    } else if (isa == Isa::SSE41) {
+        horizontal = ResampleKernels::horizontalSse41;
+        vertical = ResampleKernels::verticalSse41;
+    }
+#endif
+
+    FilterKind kind = filterKind(filter);
+    std::shared_ptr<const FilterTable> horizontalTable = filterTable(srcWidth, dstWidth, kind);
+    std::shared_ptr<const FilterTable> verticalTable = filterTable(srcHeight, dstHeight, kind);
+
+    // Only the source rows the vertical pass reads go through the
+    // horizontal pass
+    int firstRow = verticalTable->first[dstBegin];
+    int lastRow = verticalTable->first[dstEnd - 1] + verticalTable->count[dstEnd - 1];
+    int rows = lastRow - firstRow;
+    if (firstRow < srcTop) {
+        qWarning() << "Resampling output rows" << dstBegin << "to" << dstEnd << "needs source row"
+                   << firstRow << "above the stripe at" << srcTop;
+        return false;
+    }
+
+    QImage intermediate = intermediatePool().acquire(QSize(dstWidth, rows), QImage::Format_RGB32);
+    if (intermediate.isNull()) {
+        qWarning() << "Cannot allocate resampling buffer of" << dstWidth << "x" << rows;
+        return false;
+    }
+
+    horizontal(src + (firstRow - srcTop) * srcStride, srcStride,
+               intermediate.bits(), intermediate.bytesPerLine(),
+               rows, *horizontalTable);
+    vertical(intermediate.constBits(), intermediate.bytesPerLine(), firstRow,
+             dst, dstStride, dstBegin, dstEnd, dstWidth * 4,
+             *verticalTable, premultiplied);
+
+    intermediatePool().release(std::move(intermediate));
+    return true;
+}
+
+bool Resampler::sourceRows(int srcLength, int dstLength, int dstBegin, int dstEnd,
+                           ResampleFilter filter, int* first, int* last)
+{
+    if (filter == ResampleFilter::QtSmooth || srcLength <= 0 || dstLength <= 0 ||
+        dstBegin < 0 || dstEnd > dstLength || dstBegin >= dstEnd) {
+        return false;
+    }
+
+    std::shared_ptr<const FilterTable> table = filterTable(srcLength, dstLength, filterKind(filter));
+    *first = table->first[dstBegin];
+    *last = table->first[dstEnd - 1] + table->count[dstEnd - 1];
+    return true;
+}
+
+QString Resampler::filterName(ResampleFilter filter)
+{
+    switch (filter) {
+    case ResampleFilter::QtSmooth:
+        return "qt";
+    case ResampleFilter::Box:
+        return "box";
+    case ResampleFilter::Bilinear:
+        return "bilinear";
+    case ResampleFilter::Lanczos3:
+        return "lanczos3";
+    }
+    return QString();
+}
+
+bool Resampler::parseFilter(const QString& name, ResampleFilter* filter)
+{
+    const ResampleFilter filters[] = {
+        ResampleFilter::QtSmooth, ResampleFilter::Box,
+        ResampleFilter::Bilinear, ResampleFilter::Lanczos3
+    };
+
+    for (ResampleFilter candidate : filters) {
+        if (name.compare(filterName(candidate), Qt::CaseInsensitive) == 0) {
+            if (filter) {
+                *filter = candidate;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+void Resampler::clearCoefficientCache()
+{
+    QMutexLocker locker(&s_tableMutex);
+    s_tables.clear();
+}
+
+} // namespace WallpaperCore
\ No newline at end of file
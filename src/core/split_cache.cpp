@@ -0,0 +1,180 @@
+#include "core/split_cache.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QRegularExpression>
+#include <algorithm>
+#include <vector>
+
+namespace WallpaperCore {
+
+namespace {
+
+// <16 hex digit key>_<index>.<extension>
+const QRegularExpression& cacheFilePattern()
+{
+    static const QRegularExpression pattern("^([0-9a-f]{16})_(\\d+)\\.[A-Za-z0-9]+$");
+    return pattern;
+}
+
+struct CacheEntry {
+    QString key;
+    QStringList files;
+    qint64 bytes = 0;
+    QDateTime lastUsed;
+};
+
+} // namespace
+
+SplitCache::SplitCache(const QString& directory, qint64 maxBytes)
+    : m_directory(directory)
+    , m_maxBytes(maxBytes)
+{
+}
+
+QByteArray SplitCache::fileFingerprint(const QString& path)
+{
+    QFileInfo fileInfo(path);
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << fileInfo.canonicalFilePath()
+           << fileInfo.size()
+           << fileInfo.lastModified().toMSecsSinceEpoch();
+    return data;
+}
+
+QString SplitCache::keyFor(const QByteArray& parameters)
+{
+    return QString::fromLatin1(QCryptographicHash::hash(parameters, QCryptographicHash::Sha1)
+                               .toHex().left(16));
+}
+
+bool SplitCache::isCacheFileName(const QString& fileName)
+{
+    return cacheFilePattern().match(fileName).hasMatch();
+}
+
+QString SplitCache::outputPath(const QString& key, int index, const QString& extension) const
+{
+    return QDir(m_directory).filePath(QString("%1_%2.%3").arg(key).arg(index).arg(extension));
+}
+
+QStringList SplitCache::lookup(const QString& key, int count, const QString& extension)
+{
+    QStringList paths;
+    for (int i = 0; i < count; ++i) {
+        QString path = outputPath(key, i, extension);
+        QFileInfo fileInfo(path);
+        if (!fileInfo.exists() || fileInfo.size() == 0) {
+            return QStringList();
+        }
+        paths << path;
+    }
+
+    // Modification times double as the LRU order
+    QDateTime now = QDateTime::currentDateTime();
+    for (const QString& path : paths) {
+        QFile file(path);
+        if (file.open(QIODevice::ReadWrite)) {
+            file.setFileTime(now, QFileDevice::FileModificationTime);
+        }
+    }
+
+    return paths;
+}
+
+void SplitCache::remove(const QString& key)
+{
+    QDir dir(m_directory);
+    const QStringList files = dir.entryList(QStringList() << key + "_*", QDir::Files);
+    for (const QString& fileName : files) {
+        if (isCacheFileName(fileName)) {
+            dir.remove(fileName);
+        }
+    }
+}
+
+void SplitCache::evict(const QStringList& keepKeys)
+{
+    if (m_maxBytes <= 0) {
+        return;
+    }
+
+    QDir dir(m_directory);
+    QHash<QString, CacheEntry> entries;
+    qint64 total = 0;
+    const QFileInfoList files = dir.entryInfoList(QDir::Files);
+    for (const QFileInfo& fileInfo : files) {
+        QRegularExpressionMatch match = cacheFilePattern().match(fileInfo.fileName());
+        if (!match.hasMatch()) {
+            continue;
+        }
+
+        CacheEntry& entry = entries[match.captured(1)];
+        entry.key = match.captured(1);
+        entry.files << fileInfo.fileName();
+        entry.bytes += fileInfo.size();
+        if (!entry.lastUsed.isValid() || fileInfo.lastModified() > entry.lastUsed) {
+            entry.lastUsed = fileInfo.lastModified();
+        }
+        total += fileInfo.size();
+    }
+
+    if (total <= m_maxBytes) {
+        return;
+    }
+
+    std::vector<CacheEntry> byAge;
+    byAge.reserve(entries.size());
+    for (auto it = entries.cbegin(); it != entries.cend(); ++it) {
+        byAge.push_back(it.value());
+    }
+    std::sort(byAge.begin(), byAge.end(), [](const CacheEntry& a, const CacheEntry& b) {
+        return a.lastUsed < b.lastUsed;
+    });
+
+    for (const CacheEntry& entry : byAge) {
+        if (total <= m_maxBytes) {
+            break;
+        }
+        if (keepKeys.contains(entry.key)) {
+            continue;
+        }
+
+        for (const QString& fileName : entry.files) {
+            dir.remove(fileName);
+        }
+        total -= entry.bytes;
+        qDebug() << "Evicted cached split" << entry.key << "(" << entry.bytes / 1024 << "KB)";
+    }
+}
+
+qint64 SplitCache::totalBytes() const
+{
+    qint64 total = 0;
+    const QFileInfoList files = QDir(m_directory).entryInfoList(QDir::Files);
+    for (const QFileInfo& fileInfo : files) {
+        if (isCacheFileName(fileInfo.fileName())) {
+            total += fileInfo.size();
+        }
+    }
+    return total;
+}
+
+void SplitCache::clear()
+{
+    QDir dir(m_directory);
+    const QStringList files = dir.entryList(QDir::Files);
+    for (const QString& fileName : files) {
+        if (isCacheFileName(fileName)) {
+            dir.remove(fileName);
+        }
+    }
+}
+
+} // namespace WallpaperCore
@@ -0,0 +1,155 @@
+#include "core/split_plan.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDebug>
+#include <QMutexLocker>
+#include <cmath>
+
+namespace WallpaperCore {
+
+namespace {
+
+// Whether a cached plan's monitor is described the same way; geometry and
+// resolution already match through the layout key
+bool sameDescription(const MonitorInfo& a, const MonitorInfo& b)
+{
+    return a.name == b.name && a.isPrimary == b.isPrimary && a.wallpaperPath == b.wallpaperPath;
+}
+
+} // namespace
+
+SplitPlan SplitPlan::create(const QSize& sourceSize, const MonitorList& monitors)
+{
+    SplitPlan plan;
+    if (sourceSize.isEmpty() || monitors.empty()) {
+        return plan;
+    }
+
+    plan.m_key = layoutKey(sourceSize, monitors);
+    plan.m_sourceSize = sourceSize;
+
+    MonitorList sortedMonitors = sortedByPosition(monitors);
+    for (const auto& monitor : sortedMonitors) {
+        plan.m_virtualDesktop = plan.m_virtualDesktop.united(monitor.geometry);
+    }
+
+    for (int i = 0; i < static_cast<int>(sortedMonitors.size()); ++i) {
+        MonitorPlan monitorPlan;
+        monitorPlan.monitor = sortedMonitors[i];
+        monitorPlan.index = i;
+        monitorPlan.cropRect = cropRectFor(sourceSize, sortedMonitors[i].geometry,
+                                           plan.m_virtualDesktop);
+        // Scaled outputs report a logical geometry smaller than their
+        // pixels; the wallpaper is written at the real resolution
+        const QSize& resolution = sortedMonitors[i].actualResolution;
+        monitorPlan.targetSize = resolution.isEmpty() ? sortedMonitors[i].geometry.size() : resolution;
+
+        if (!monitorPlan.targetSize.isEmpty()) {
+            monitorPlan.scaleX = static_cast<double>(monitorPlan.cropRect.width())
+                                 / monitorPlan.targetSize.width();
+            monitorPlan.scaleY = static_cast<double>(monitorPlan.cropRect.height())
+                                 / monitorPlan.targetSize.height();
+        }
+        monitorPlan.transformation = monitorPlan.needsScaling()
+                                     ? Qt::SmoothTransformation
+                                     : Qt::FastTransformation;
+
+        plan.m_monitors.push_back(monitorPlan);
+    }
+
+    return plan;
+}
+
+QByteArray SplitPlan::layoutKey(const QSize& sourceSize, const MonitorList& monitors)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << sourceSize;
+    for (const auto& monitor : sortedByPosition(monitors)) {
+        stream << monitor.geometry << monitor.actualResolution;
+    }
+
+    return QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex();
+}
+
+SplitPlan SplitPlan::withMonitors(const MonitorList& monitors) const
+{
+    SplitPlan plan = *this;
+    MonitorList sortedMonitors = sortedByPosition(monitors);
+    for (size_t i = 0; i < plan.m_monitors.size() && i < sortedMonitors.size(); ++i) {
+        plan.m_monitors[i].monitor = sortedMonitors[i];
+    }
+    return plan;
+}
+
+QRect SplitPlan::cropRectFor(const QSize& sourceSize,
+                             const QRect& geometry,
+                             const QRect& virtualDesktop)
+{
+    if (virtualDesktop.isEmpty()) {
+        return QRect();
+    }
+
+    // Calculate the scale factor between image and virtual desktop
+    double scaleX = static_cast<double>(sourceSize.width()) / virtualDesktop.width();
+    double scaleY = static_cast<double>(sourceSize.height()) / virtualDesktop.height();
+
+    // Round the edges rather than the size so neighbouring crops share edges
+    int left = static_cast<int>(std::lround((geometry.x() - virtualDesktop.x()) * scaleX));
+    int top = static_cast<int>(std::lround((geometry.y() - virtualDesktop.y()) * scaleY));
+    int right = static_cast<int>(std::lround((geometry.x() + geometry.width() - virtualDesktop.x()) * scaleX));
+    int bottom = static_cast<int>(std::lround((geometry.y() + geometry.height() - virtualDesktop.y()) * scaleY));
+
+    QRect cropRect(left, top, right - left, bottom - top);
+    return cropRect.intersected(QRect(QPoint(0, 0), sourceSize));
+}
+
+SplitPlanCache::SplitPlanCache(int capacity)
+    : m_capacity(qMax(1, capacity))
+{
+}
+
+std::shared_ptr<const SplitPlan> SplitPlanCache::plan(const QSize& sourceSize,
+                                                      const MonitorList& monitors)
+{
+    QByteArray key = SplitPlan::layoutKey(sourceSize, monitors);
+
+    QMutexLocker locker(&m_mutex);
+    auto it = m_plans.constFind(key);
+    if (it != m_plans.constEnd()) {
+        m_recentKeys.removeOne(key);
+        m_recentKeys.append(key);
+        std::shared_ptr<const SplitPlan> cached = it.value();
+        locker.unlock();
+
+        // The key only covers geometry, so a renamed connector or a new
+        // primary monitor gets the cached geometry with its own description
+        MonitorList sortedMonitors = sortedByPosition(monitors);
+        for (size_t i = 0; i < sortedMonitors.size(); ++i) {
+            if (!sameDescription(cached->monitors()[i].monitor, sortedMonitors[i])) {
+                return std::make_shared<const SplitPlan>(cached->withMonitors(monitors));
+            }
+        }
+        return cached;
+    }
+
+    auto plan = std::make_shared<const SplitPlan>(SplitPlan::create(sourceSize, monitors));
+    m_plans.insert(key, plan);
+    m_recentKeys.append(key);
+
+    while (m_recentKeys.size() > m_capacity) {
+        m_plans.remove(m_recentKeys.takeFirst());
+    }
+
+    qDebug() << "Computed split plan" << key << "for source size" << sourceSize;
+    return plan;
+}
+
+void SplitPlanCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_plans.clear();
+    m_recentKeys.clear();
+}
+
+} // namespace WallpaperCore
\ No newline at end of file
@@ -0,0 +1,205 @@
+#include "core/split_prefetcher.h"
+#include "core/split_plan.h"
+#include <QDebug>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QThread>
+#include <algorithm>
+
+namespace WallpaperCore {
+
+namespace {
+
+bool sameLayout(const MonitorList& a, const MonitorList& b)
+{
+    return SplitPlan::layoutKey(QSize(), a) == SplitPlan::layoutKey(QSize(), b);
+}
+
+} // namespace
+
+SplitPrefetcher::SplitPrefetcher(QObject* parent)
+    : QObject(parent)
+    , m_cancelCurrent(false)
+    , m_running(false)
+    , m_memoryBudget(DefaultMemoryBudget)
+    , m_diskBudget(DefaultDiskBudget)
+    , m_bytesWritten(0)
+{
+    // One background split at a time, each on a single thread, so the
+    // desktop stays responsive while images are prepared
+    m_pool.setMaxThreadCount(1);
+    m_splitter.setThreadCount(1);
+    m_splitter.setCancelFlag(&m_cancelCurrent);
+}
+
+SplitPrefetcher::~SplitPrefetcher()
+{
+    cancel();
+    m_pool.waitForDone();
+}
+
+void SplitPrefetcher::setSplitterSettings(const ImageSplitter& splitter)
+{
+    QMutexLocker locker(&m_mutex);
+    m_settings.copySettingsFrom(splitter);
+}
+
+void SplitPrefetcher::setMemoryBudget(qint64 bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_memoryBudget = qMax<qint64>(0, bytes);
+}
+
+qint64 SplitPrefetcher::memoryBudget() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_memoryBudget;
+}
+
+void SplitPrefetcher::setDiskBudget(qint64 bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_diskBudget = qMax<qint64>(0, bytes);
+}
+
+qint64 SplitPrefetcher::diskBudget() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_diskBudget;
+}
+
+void SplitPrefetcher::prefetch(const QStringList& imagePaths,
+                               const MonitorList& monitors,
+                               const QString& outputDir)
+{
+    QList<PrefetchJob> jobs;
+    for (const QString& imagePath : imagePaths) {
+        jobs.append(PrefetchJob{imagePath, monitors});
+    }
+    prefetch(jobs, outputDir);
+}
+
+void SplitPrefetcher::prefetch(const QList<PrefetchJob>& jobs, const QString& outputDir)
+{
+    QMutexLocker locker(&m_mutex);
+    m_queue.clear();
+    for (const PrefetchJob& job : jobs) {
+        bool queued = std::any_of(m_queue.cbegin(), m_queue.cend(), [&job](const PrefetchJob& other) {
+            return other.imagePath == job.imagePath && sameLayout(other.monitors, job.monitors);
+        });
+        if (!job.imagePath.isEmpty() && !job.monitors.empty() && !queued) {
+            m_queue.append(job);
+        }
+    }
+    m_outputDir = outputDir;
+
+    if (!m_running && !m_queue.isEmpty()) {
+        m_running = true;
+        m_pool.start([this]() { run(); });
+    }
+}
+
+void SplitPrefetcher::setKeepKey(const QString& key)
+{
+    QMutexLocker locker(&m_mutex);
+    if (key != m_keepKey) {
+        m_keepKey = key;
+        m_bytesWritten = 0;
+    }
+}
+
+void SplitPrefetcher::cancel()
+{
+    QMutexLocker locker(&m_mutex);
+    m_queue.clear();
+}
+
+void SplitPrefetcher::waitFor(const QString& imagePath, const MonitorList& monitors)
+{
+    QMutexLocker locker(&m_mutex);
+    m_queue.erase(std::remove_if(m_queue.begin(), m_queue.end(),
+                                 [&](const PrefetchJob& job) {
+                                     return job.imagePath == imagePath &&
+                                            sameLayout(job.monitors, monitors);
+                                 }),
+                  m_queue.end());
+    // A single-threaded low-priority split would keep the caller waiting
+    // far longer than splitting it again in the foreground
+    if (!imagePath.isEmpty() && m_current == imagePath) {
+        m_cancelCurrent = true;
+    }
+    while (!imagePath.isEmpty() && m_current == imagePath) {
+        m_currentDone.wait(&m_mutex);
+    }
+}
+
+bool SplitPrefetcher::isIdle() const
+{
+    QMutexLocker locker(&m_mutex);
+    return !m_running;
+}
+
+void SplitPrefetcher::run()
+{
+    QThread::currentThread()->setPriority(QThread::LowPriority);
+
+    forever {
+        QString imagePath;
+        MonitorList monitors;
+        QString outputDir;
+        {
+            QMutexLocker locker(&m_mutex);
+            bool overBudget = m_diskBudget > 0 && m_bytesWritten >= m_diskBudget;
+            if (m_queue.isEmpty() || overBudget) {
+                if (overBudget && !m_queue.isEmpty()) {
+                    qDebug() << "Prefetch disk budget reached; skipping" << m_queue.size() << "image(s)";
+                    m_queue.clear();
+                }
+                m_running = false;
+                break;
+            }
+
+            PrefetchJob job = m_queue.takeFirst();
+            imagePath = job.imagePath;
+            monitors = job.monitors;
+            outputDir = m_outputDir;
+            m_current = imagePath;
+            m_cancelCurrent = false;
+
+            m_splitter.copySettingsFrom(m_settings);
+            m_splitter.setKeepKey(m_keepKey);
+            if (m_memoryBudget > 0 && (m_splitter.memoryLimit() == 0 ||
+                                       m_splitter.memoryLimit() > m_memoryBudget)) {
+                m_splitter.setMemoryLimit(m_memoryBudget);
+            }
+        }
+
+        bool success = m_splitter.splitImage(imagePath, monitors, outputDir);
+        bool cached = m_splitter.lastSplitCached();
+        bool cancelled = m_cancelCurrent;
+
+        qint64 bytes = 0;
+        if (success && !cached) {
+            for (const auto& result : m_splitter.lastResults()) {
+                bytes += QFileInfo(result.outputPath).size();
+            }
+        }
+        {
+            QMutexLocker locker(&m_mutex);
+            m_bytesWritten += bytes;
+            m_current.clear();
+            m_currentDone.wakeAll();
+        }
+
+        if (cancelled && !success) {
+            qDebug() << "Prefetch of" << imagePath << "handed over to the foreground";
+            continue;
+        }
+        qDebug() << "Prefetched" << imagePath << (success ? (cached ? "(cached)" : "") : "FAILED");
+        emit imagePrefetched(imagePath, success, cached);
+    }
+
+    emit finished();
+}
+
+} // namespace WallpaperCore
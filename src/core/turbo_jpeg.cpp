@@ -0,0 +1,503 @@
+#include "core/turbo_jpeg.h"
+#include <QDebug>
+#include <QFile>
+#include <QIODevice>
+#include <QSaveFile>
+
+#ifdef WALLPAPER_HAVE_TURBOJPEG
+#include <turbojpeg.h>
+#endif
+
+#ifdef WALLPAPER_HAVE_LIBJPEG
+#include <csetjmp>
+#include <cstdio>
+#include <jpeglib.h>
+#endif
+
+namespace WallpaperCore {
+namespace TurboJpeg {
+
+#ifdef WALLPAPER_HAVE_TURBOJPEG
+
+namespace {
+
+// QImage::Format_RGB32 in memory byte order; the X byte is 0xff on decode
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+constexpr int Rgb32PixelFormat = TJPF_BGRX;
+#else
+constexpr int Rgb32PixelFormat = TJPF_XRGB;
+#endif
+
+// TurboJPEG handles are not thread-safe but are reusable, so each worker
+// thread keeps its own pair for the lifetime of the thread
+struct Handles {
+    tjhandle compressor = nullptr;
+    tjhandle decompressor = nullptr;
+    tjhandle transformer = nullptr;
+
+    ~Handles()
+    {
+        if (compressor) {
+            tjDestroy(compressor);
+        }
+        if (decompressor) {
+            tjDestroy(decompressor);
+        }
+        if (transformer) {
+            tjDestroy(transformer);
+        }
+    }
+};
+
+thread_local Handles t_handles;
+
+tjhandle compressor()
+{
+    if (!t_handles.compressor) {
+        t_handles.compressor = tjInitCompress();
+    }
+    return t_handles.compressor;
+}
+
+tjhandle decompressor()
+{
+    if (!t_handles.decompressor) {
+        t_handles.decompressor = tjInitDecompress();
+    }
+    return t_handles.decompressor;
+}
+
+tjhandle transformer()
+{
+    if (!t_handles.transformer) {
+        t_handles.transformer = tjInitTransform();
+    }
+    return t_handles.transformer;
+}
+
+// Memory-mapped JPEG file. data is null for files that are not JPEG.
+struct MappedJpeg {
+    QFile file;
+    const uchar* data = nullptr;
+    qint64 size = 0;
+
+    explicit MappedJpeg(const QString& path)
+        : file(path)
+    {
+        if (!file.open(QIODevice::ReadOnly) || file.size() < 2) {
+            return;
+        }
+        const uchar* mapped = file.map(0, file.size());
+        if (mapped && mapped[0] == 0xff && mapped[1] == 0xd8) {
+            data = mapped;
+            size = file.size();
+        }
+    }
+};
+
+int subsamplingFor(ChromaSubsampling subsampling)
+{
+    switch (subsampling) {
+    case ChromaSubsampling::S444:
+        return TJSAMP_444;
+    case ChromaSubsampling::S422:
+        return TJSAMP_422;
+    case ChromaSubsampling::S420:
+        break;
+    }
+    return TJSAMP_420;
+}
+
+// Whether one of the DCT scaling factors turns size into scaledSize
+bool hasScalingFactor(const QSize& size, const QSize& scaledSize)
+{
+    int count = 0;
+    tjscalingfactor* factors = tjGetScalingFactors(&count);
+    for (int i = 0; i < count; ++i) {
+        if (TJSCALED(size.width(), factors[i]) == scaledSize.width() &&
+            TJSCALED(size.height(), factors[i]) == scaledSize.height()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Decode JPEG data in memory; see decode()
+QImage decodeData(const uchar* data, qint64 dataSize, const QSize& scaledSize)
+{
+    tjhandle handle = decompressor();
+    if (!handle) {
+        return QImage();
+    }
+
+    int width = 0;
+    int height = 0;
+    int subsampling = 0;
+    int colorspace = 0;
+    if (tjDecompressHeader3(handle, data, static_cast<unsigned long>(dataSize),
+                            &width, &height, &subsampling, &colorspace) != 0) {
+        return QImage();
+    }
+
+    // CMYK and YCCK cannot be converted to RGB by TurboJPEG
+    if (colorspace == TJCS_CMYK || colorspace == TJCS_YCCK) {
+        return QImage();
+    }
+
+    QSize size(width, height);
+    if (scaledSize.isValid() && scaledSize != size) {
+        if (!hasScalingFactor(size, scaledSize)) {
+            return QImage();
+        }
+        size = scaledSize;
+    }
+
+    QImage image(size, QImage::Format_RGB32);
+    if (image.isNull()) {
+        qWarning() << "Failed to allocate decoded image of size" << size;
+        return QImage();
+    }
+
+    if (tjDecompress2(handle, data, static_cast<unsigned long>(dataSize),
+                      image.bits(), size.width(), static_cast<int>(image.bytesPerLine()),
+                      size.height(), Rgb32PixelFormat, 0) != 0) {
+        qDebug() << "libjpeg-turbo could not decode JPEG data:" << tjGetErrorStr2(handle);
+        return QImage();
+    }
+
+    return image;
+}
+
+} // namespace
+
+bool isAvailable()
+{
+    return true;
+}
+
+QImage decode(const QString& path, const QSize& scaledSize)
+{
+    // Map the file instead of reading it, and skip anything that isn't JPEG
+    MappedJpeg jpeg(path);
+    if (!jpeg.data) {
+        return QImage();
+    }
+    return decodeData(jpeg.data, jpeg.size, scaledSize);
+}
+
+QImage decode(const QByteArray& data, const QSize& scaledSize)
+{
+    const uchar* bytes = reinterpret_cast<const uchar*>(data.constData());
+    if (data.size() < 2 || bytes[0] != 0xff || bytes[1] != 0xd8) {
+        return QImage();
+    }
+    return decodeData(bytes, data.size(), scaledSize);
+}
+
+bool encode(const QImage& image, QIODevice* device, int quality,
+            const JpegOptions& options)
+{
+    if (image.isNull() || !device) {
+        return false;
+    }
+
+    tjhandle handle = compressor();
+    if (!handle) {
+        qWarning() << "Failed to initialise libjpeg-turbo compressor";
+        return false;
+    }
+
+    // JPEG has no alpha; the X byte of RGB32 is ignored while compressing
+    const QImage source = image.format() == QImage::Format_RGB32
+                          ? image : image.convertToFormat(QImage::Format_RGB32);
+
+    int flags = options.fastDct ? TJFLAG_FASTDCT : TJFLAG_ACCURATEDCT;
+#ifdef TJFLAG_PROGRESSIVE
+    if (options.progressive) {
+        flags |= TJFLAG_PROGRESSIVE;
+    }
+#endif
+
+    unsigned char* jpegData = nullptr;
+    unsigned long jpegSize = 0;
+    if (tjCompress2(handle, source.constBits(), source.width(),
+                    static_cast<int>(source.bytesPerLine()), source.height(),
+                    Rgb32PixelFormat, &jpegData, &jpegSize,
+                    subsamplingFor(options.subsampling), quality, flags) != 0) {
+        qWarning() << "libjpeg-turbo failed to encode image:" << tjGetErrorStr2(handle);
+        tjFree(jpegData);
+        return false;
+    }
+
+    const qint64 written = device->write(reinterpret_cast<const char*>(jpegData), qint64(jpegSize));
+    tjFree(jpegData);
+    if (written != qint64(jpegSize)) {
+        qWarning() << "Failed to write JPEG image:" << device->errorString();
+        return false;
+    }
+
+    return true;
+}
+
+QSize mcuSize(const QString& path)
+{
+    MappedJpeg jpeg(path);
+    tjhandle handle = decompressor();
+    if (!jpeg.data || !handle) {
+        return QSize();
+    }
+
+    int width = 0;
+    int height = 0;
+    int subsampling = 0;
+    int colorspace = 0;
+    if (tjDecompressHeader3(handle, jpeg.data, static_cast<unsigned long>(jpeg.size),
+                            &width, &height, &subsampling, &colorspace) != 0 ||
+        subsampling < 0 || subsampling >= TJ_NUMSAMP) {
+        return QSize();
+    }
+
+    return QSize(tjMCUWidth[subsampling], tjMCUHeight[subsampling]);
+}
+
+bool cropLossless(const QString& path, const QRect& rect,
+                  const QString& outputPath, bool progressive)
+{
+    MappedJpeg jpeg(path);
+    tjhandle handle = transformer();
+    if (!jpeg.data || !handle || rect.isEmpty()) {
+        return false;
+    }
+
+    tjtransform transform = {};
+    transform.r.x = rect.x();
+    transform.r.y = rect.y();
+    transform.r.w = rect.width();
+    transform.r.h = rect.height();
+    transform.op = TJXOP_NONE;
+    // Drop EXIF and other markers: a stale orientation tag would otherwise
+    // rotate the crop, and the re-encoding path writes none either
+    transform.options = TJXOPT_CROP | TJXOPT_COPYNONE;
+#ifdef TJXOPT_PROGRESSIVE
+    if (progressive) {
+        transform.options |= TJXOPT_PROGRESSIVE;
+    }
+#else
+    Q_UNUSED(progressive);
+#endif
+
+    unsigned char* output = nullptr;
+    unsigned long outputSize = 0;
+    if (tjTransform(handle, jpeg.data, static_cast<unsigned long>(jpeg.size), 1,
+                    &output, &outputSize, &transform, 0) != 0) {
+        qWarning() << "Lossless crop of" << rect << "from" << path << "failed:" << tjGetErrorStr2(handle);
+        tjFree(output);
+        return false;
+    }
+
+    QSaveFile file(outputPath);
+    bool written = file.open(QIODevice::WriteOnly)
+                   && file.write(reinterpret_cast<const char*>(output), qint64(outputSize)) == qint64(outputSize)
+                   && file.commit();
+    tjFree(output);
+    if (!written) {
+        qWarning() << "Failed to write" << outputPath << ":" << file.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+#else // WALLPAPER_HAVE_TURBOJPEG
+
+bool isAvailable()
+{
+    return false;
+}
+
+QImage decode(const QString&, const QSize&)
+{
+    return QImage();
+}
+
+QImage decode(const QByteArray&, const QSize&)
+{
+    return QImage();
+}
+
+bool encode(const QImage&, QIODevice*, int, const JpegOptions&)
+{
+    return false;
+}
+
+QSize mcuSize(const QString&)
+{
+    return QSize();
+}
+
+bool cropLossless(const QString&, const QRect&, const QString&, bool)
+{
+    return false;
+}
+
+#endif // WALLPAPER_HAVE_TURBOJPEG
+
+#if defined(WALLPAPER_HAVE_LIBJPEG) && defined(JCS_EXTENSIONS)
+
+namespace {
+
+// libjpeg reports fatal errors through error_exit, which must not return
+struct ErrorManager {
+    jpeg_error_mgr base;
+    std::jmp_buf jump;
+};
+
+void exitOnError(j_common_ptr info)
+{
+    std::longjmp(reinterpret_cast<ErrorManager*>(info->err)->jump, 1);
+}
+
+// Warnings about recoverable corrupt data are not worth a log line each
+void ignoreMessage(j_common_ptr)
+{
+}
+
+} // namespace
+
+struct ScanlineDecoder::State {
+    QFile file;
+    jpeg_decompress_struct info;
+    ErrorManager error;
+    bool created = false;
+
+    ~State()
+    {
+        if (created) {
+            jpeg_destroy_decompress(&info);
+        }
+    }
+};
+
+ScanlineDecoder::ScanlineDecoder(const QString& path, const QSize& scaledSize)
+    : m_state(new State)
+{
+    State& state = *m_state;
+    state.file.setFileName(path);
+    const uchar* data = nullptr;
+    if (state.file.open(QIODevice::ReadOnly) && state.file.size() >= 2) {
+        data = state.file.map(0, state.file.size());
+    }
+    if (!data || data[0] != 0xff || data[1] != 0xd8) {
+        m_state.reset();
+        return;
+    }
+
+    state.info.err = jpeg_std_error(&state.error.base);
+    state.error.base.error_exit = exitOnError;
+    state.error.base.output_message = ignoreMessage;
+    if (setjmp(state.error.jump)) {
+        m_state.reset();
+        return;
+    }
+
+    jpeg_create_decompress(&state.info);
+    state.created = true;
+    jpeg_mem_src(&state.info, data, static_cast<unsigned long>(state.file.size()));
+    jpeg_read_header(&state.info, TRUE);
+
+    // Same limits and settings as decode(): no CMYK, accurate DCT, fancy
+    // upsampling
+    if (state.info.jpeg_color_space == JCS_CMYK || state.info.jpeg_color_space == JCS_YCCK) {
+        m_state.reset();
+        return;
+    }
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    state.info.out_color_space = JCS_EXT_BGRX;
+#else
+    state.info.out_color_space = JCS_EXT_XRGB;
+#endif
+
+    jpeg_calc_output_dimensions(&state.info);
+    for (unsigned int denominator = 2; scaledSize.isValid() && denominator <= 8 &&
+         QSize(int(state.info.output_width), int(state.info.output_height)) != scaledSize;
+         denominator *= 2) {
+        state.info.scale_num = 1;
+        state.info.scale_denom = denominator;
+        jpeg_calc_output_dimensions(&state.info);
+    }
+    if (scaledSize.isValid() && QSize(int(state.info.output_width), int(state.info.output_height)) != scaledSize) {
+        m_state.reset();
+        return;
+    }
+
+    jpeg_start_decompress(&state.info);
+}
+
+ScanlineDecoder::~ScanlineDecoder() = default;
+
+bool ScanlineDecoder::isAvailable()
+{
+    return true;
+}
+
+QSize ScanlineDecoder::size() const
+{
+    return m_state ? QSize(int(m_state->info.output_width), int(m_state->info.output_height)) : QSize();
+}
+
+int ScanlineDecoder::nextRow() const
+{
+    return m_state ? int(m_state->info.output_scanline) : 0;
+}
+
+bool ScanlineDecoder::readRow(uchar* row)
+{
+    if (!m_state || m_state->info.output_scanline >= m_state->info.output_height) {
+        return false;
+    }
+
+    if (setjmp(m_state->error.jump)) {
+        qDebug() << "libjpeg could not decode" << m_state->file.fileName();
+        m_state.reset();
+        return false;
+    }
+
+    JSAMPROW rows[1] = {row};
+    return jpeg_read_scanlines(&m_state->info, rows, 1) == 1;
+}
+
+#else // WALLPAPER_HAVE_LIBJPEG
+
+struct ScanlineDecoder::State {
+};
+
+ScanlineDecoder::ScanlineDecoder(const QString&, const QSize&)
+{
+}
+
+ScanlineDecoder::~ScanlineDecoder() = default;
+
+bool ScanlineDecoder::isAvailable()
+{
+    return false;
+}
+
+QSize ScanlineDecoder::size() const
+{
+    return QSize();
+}
+
+int ScanlineDecoder::nextRow() const
+{
+    return 0;
+}
+
+bool ScanlineDecoder::readRow(uchar*)
+{
+    return false;
+}
+
+#endif // WALLPAPER_HAVE_LIBJPEG
+
+} // namespace TurboJpeg
+} // namespace WallpaperCore
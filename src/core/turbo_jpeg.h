@@ -0,0 +1,82 @@
+#pragma once
+
+// Internal libjpeg-turbo backend. Every function is safe to call in builds
+// without libjpeg-turbo: they report failure and callers fall back to Qt.
+
+#include "core/image_encoder.h"
+#include <QByteArray>
+#include <QImage>
+#include <QRect>
+#include <QSize>
+#include <QString>
+#include <memory>
+
+class QIODevice;
+
+namespace WallpaperCore {
+namespace TurboJpeg {
+
+// Whether the build links libjpeg-turbo
+bool isAvailable();
+
+// Decode a JPEG file to RGB32. A valid scaledSize must match one of
+// libjpeg-turbo's DCT scaling factors exactly. Returns a null image for
+// files that are not JPEG or that libjpeg-turbo cannot decode (e.g. CMYK),
+// without warning, so the caller can retry with Qt.
+QImage decode(const QString& path, const QSize& scaledSize = QSize());
+
+// Decode JPEG data held in memory, like decode(path)
+QImage decode(const QByteArray& data, const QSize& scaledSize = QSize());
+
+// Encode an image as JPEG with the given quality and options
+bool encode(const QImage& image, QIODevice* device, int quality,
+            const JpegOptions& options);
+
+// Size of a JPEG file's MCU (8x8 to 16x16 depending on chroma subsampling).
+// Lossless crops must start on a multiple of it. Returns an invalid size
+// for files that are not JPEG or without libjpeg-turbo.
+QSize mcuSize(const QString& path);
+
+// Cut rect out of a JPEG file in the DCT domain and write it to outputPath,
+// without decoding or re-encoding any pixels. rect's top-left corner must
+// be MCU-aligned; its size is arbitrary. Metadata is not copied.
+bool cropLossless(const QString& path, const QRect& rect,
+                  const QString& outputPath, bool progressive);
+
+// Decodes a JPEG file to RGB32 one row at a time, top to bottom, so a
+// source too large to hold decoded is decoded only once however many
+// stripes it is split in. Rows match decode() exactly. Uses libjpeg-turbo's
+// libjpeg API; isOpen() is false without it and for files it cannot
+// decode to RGB, and callers fall back to Qt.
+class ScanlineDecoder {
+public:
+    // A valid scaledSize must match a 1/2, 1/4 or 1/8 DCT scaling exactly
+    explicit ScanlineDecoder(const QString& path, const QSize& scaledSize = QSize());
+    ~ScanlineDecoder();
+
+    ScanlineDecoder(const ScanlineDecoder&) = delete;
+    ScanlineDecoder& operator=(const ScanlineDecoder&) = delete;
+
+    // Whether the build has the libjpeg API this decoder needs
+    static bool isAvailable();
+
+    bool isOpen() const { return m_state != nullptr; }
+
+    // Decoded (possibly scaled) size
+    QSize size() const;
+
+    // Row the next readRow() decodes
+    int nextRow() const;
+
+    // Decode the next row into size().width() RGB32 pixels at row. Returns
+    // false past the last row or on a decode error, which also closes the
+    // decoder.
+    bool readRow(uchar* row);
+
+private:
+    struct State;
+    std::unique_ptr<State> m_state;
+};
+
+} // namespace TurboJpeg
+} // namespace WallpaperCore
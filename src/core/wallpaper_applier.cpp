@@ -1,74 +1,100 @@
 #include "core/wallpaper_applier.h"
+#include "core/plasma_shell.h"
+#include "core/split_cache.h"
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
 #include <QDebug>
+#include <QEventLoop>
+#include <QFileInfo>
 #include <QProcess>
 #include <QStandardPaths>
 #include <QDir>
 #include <QSettings>
+#include <QTimer>
 #include <algorithm>
 
 namespace WallpaperCore {
 
+ApplyJob::ApplyJob(const MonitorList& monitors, QObject* parent)
+    : QObject(parent)
+    , m_monitors(monitors)
+    , m_finished(false)
+    , m_success(false)
+    , m_replacesAppliedState(false)
+{
+}
+
+bool ApplyJob::waitForFinished()
+{
+    if (m_finished) {
+        return m_success;
+    }
+    
+    // The job deletes itself once finished, so the result is taken from
+    // the signal rather than read back afterwards
+    bool success = false;
+    QEventLoop loop;
+    connect(this, &ApplyJob::finished, &loop, [&loop, &success](bool ok) {
+        success = ok;
+        loop.quit();
+    });
+    loop.exec();
+    return success;
+}
+
 WallpaperApplier::WallpaperApplier(QObject* parent)
     : QObject(parent)
+    , m_timeout(DefaultTimeout)
 {
 }
 
 bool WallpaperApplier::applyWallpaper(const MonitorInfo& monitor, 
                                      const QString& wallpaperPath)
 {
+    return applyWallpaperAsync(monitor, wallpaperPath)->waitForFinished();
+}
+
+bool WallpaperApplier::applyWallpapers(const MonitorList& monitors)
+{
+    return applyWallpapersAsync(monitors)->waitForFinished();
+}
+
+ApplyJob* WallpaperApplier::applyWallpaperAsync(const MonitorInfo& monitor,
+                                                const QString& wallpaperPath)
+{
+    MonitorInfo target = monitor;
+    target.wallpaperPath = wallpaperPath;
+    MonitorList monitors{target};
+    
     if (!isSupported()) {
         qWarning() << "Desktop environment not supported:" << getDesktopEnvironment();
-        return false;
+        return finishedJob(monitors, false, "Desktop environment not supported");
     }
     
     QFileInfo fileInfo(wallpaperPath);
     if (!fileInfo.exists()) {
         qWarning() << "Wallpaper file does not exist:" << wallpaperPath;
-        emit wallpaperFailed(monitor, "Wallpaper file does not exist");
-        return false;
+        return finishedJob(monitors, false, "Wallpaper file does not exist");
     }
     
     // For KDE Plasma, we use the plasma-apply-wallpaperimage command
     // This applies to the entire desktop (all monitors)
-    QProcess process;
-    QStringList arguments;
-    arguments << wallpaperPath;
-    
-    process.start("plasma-apply-wallpaperimage", arguments);
-    
-    if (!process.waitForFinished(10000)) { // 10 second timeout
-        qWarning() << "Timeout applying wallpaper to monitor:" << monitor.name;
-        emit wallpaperFailed(monitor, "Timeout applying wallpaper");
-        return false;
-    }
-    
-    if (process.exitCode() != 0) {
-        QString error = QString::fromUtf8(process.readAllStandardError());
-        qWarning() << "Failed to apply wallpaper to monitor" << monitor.name 
-                   << ":" << error;
-        emit wallpaperFailed(monitor, error);
-        return false;
-    }
-    
-    qDebug() << "Successfully applied wallpaper to monitor:" << monitor.name;
-    emit wallpaperApplied(monitor, wallpaperPath);
-    return true;
+    ApplyJob* job = startJob(monitors, "plasma-apply-wallpaperimage", QStringList() << wallpaperPath);
+    job->m_appliedState.insert("*", wallpaperIdentity(wallpaperPath));
+    job->m_replacesAppliedState = true;
+    return job;
 }
 
-bool WallpaperApplier::applyWallpapers(const MonitorList& monitors)
+ApplyJob* WallpaperApplier::applyWallpapersAsync(const MonitorList& monitors)
 {
     // For KDE Plasma, we need to set different wallpaper images for each monitor
     // using the DBus interface with JavaScript scripting
     if (monitors.empty()) {
-        return false;
+        return finishedJob(monitors, false, "No monitors given");
     }
     
-    // Sort monitors by x position (left to right) to match the order we split the image
-    MonitorList sortedMonitors = monitors;
-    std::sort(sortedMonitors.begin(), sortedMonitors.end(), 
-              [](const MonitorInfo& a, const MonitorInfo& b) {
-                  return a.geometry.x() < b.geometry.x();
-              });
+    // Sort monitors (left to right, top to bottom) to match the order we split the image
+    MonitorList sortedMonitors = sortedByPosition(monitors);
     
     // Filter out disabled monitors (those with empty wallpaperPath)
     MonitorList enabledMonitors;
@@ -80,7 +106,7 @@ bool WallpaperApplier::applyWallpapers(const MonitorList& monitors)
     
     if (enabledMonitors.empty()) {
         qDebug() << "No enabled monitors found";
-        return false;
+        return finishedJob(enabledMonitors, false, "No enabled monitors");
     }
     
     // Check if this is a single monitor setup (original image path, not split)
@@ -88,9 +114,7 @@ bool WallpaperApplier::applyWallpapers(const MonitorList& monitors)
     if (enabledMonitors.size() == 1) {
         QFileInfo wallpaperFile(enabledMonitors[0].wallpaperPath);
         // Check if the wallpaper path is the original image (not a split image)
-        if (!wallpaperFile.fileName().startsWith("wallpaper_") && 
-            !wallpaperFile.fileName().startsWith("a_wallpaper_") && 
-            !wallpaperFile.fileName().startsWith("b_wallpaper_")) {
+        if (!SplitCache::isCacheFileName(wallpaperFile.fileName())) {
             isSingleMonitor = true;
             qDebug() << "Single monitor mode detected - applying original image directly";
         }
@@ -98,6 +122,13 @@ bool WallpaperApplier::applyWallpapers(const MonitorList& monitors)
     
     // For single monitor, use a simplified DBus script
     if (isSingleMonitor) {
+        // Same image on every desktop as last time: nothing to do
+        QByteArray fingerprint = wallpaperIdentity(enabledMonitors[0].wallpaperPath);
+        if (m_appliedWallpapers.size() == 1 && m_appliedWallpapers.value("*") == fingerprint) {
+            qDebug() << "Wallpaper unchanged - skipping DBus call";
+            return finishedJob(enabledMonitors, true);
+        }
+        
         qDebug() << "Using simplified DBus script for single monitor";
         
         QString imagePath = QString("file://%1").arg(enabledMonitors[0].wallpaperPath);
@@ -119,61 +150,30 @@ for (let i = 0; i < ds.length; i++) {
         qDebug() << "Image path:" << imagePath;
         
         // Execute the script via DBus
-        QProcess process;
-        process.start("qdbus", QStringList() << "org.kde.plasmashell" << "/PlasmaShell" 
-                     << "org.kde.PlasmaShell.evaluateScript" << script);
-        
-        if (!process.waitForFinished(10000)) { // 10 second timeout
-            qWarning() << "Timeout executing single monitor DBus script";
-            return false;
-        }
-        
-        if (process.exitCode() != 0) {
-            QString error = QString::fromUtf8(process.readAllStandardError());
-            qWarning() << "Failed to execute single monitor DBus script:" << error;
-            return false;
-        }
-        
-        qDebug() << "Successfully executed single monitor DBus script";
-        qDebug() << "Script output:" << QString::fromUtf8(process.readAllStandardOutput());
-        
-        return true;
+        ApplyJob* job = startScriptJob(enabledMonitors, script);
+        job->m_appliedState.insert("*", fingerprint);
+        job->m_replacesAppliedState = true;
+        return job;
     }
     
-    // Determine which prefix to use (use the most recently created files)
-    QString outputDir;
-    if (!enabledMonitors.empty() && !enabledMonitors[0].wallpaperPath.isEmpty()) {
-        QFileInfo fileInfo(enabledMonitors[0].wallpaperPath);
-        outputDir = fileInfo.absolutePath();
-    } else {
-        outputDir = QStandardPaths::writableLocation(QStandardPaths::TempLocation) + "/wallpaper-splitter";
+    // Only desktops whose image changed are reconfigured, so plasmashell
+    // doesn't reload and cross-fade screens that stay the same
+    MonitorList changedMonitors;
+    QHash<QString, QByteArray> appliedState;
+    for (const auto& monitor : enabledMonitors) {
+        QString key = monitorKey(monitor);
+        QByteArray fingerprint = wallpaperIdentity(monitor.wallpaperPath);
+        if (m_appliedWallpapers.value(key) != fingerprint) {
+            changedMonitors.push_back(monitor);
+            appliedState.insert(key, fingerprint);
+        }
     }
     
-    // Check which prefix has the most recently created files
-    QString prefix = "a_";
-    QFileInfo testFileA(QString("%1/a_wallpaper_0.jpg").arg(outputDir));
-    QFileInfo testFileB(QString("%1/b_wallpaper_0.jpg").arg(outputDir));
-    
-    if (testFileA.exists() && testFileB.exists()) {
-        // Both exist, use the newer one
-        if (testFileA.lastModified() > testFileB.lastModified()) {
-            prefix = "a_";
-            qDebug() << "Using a_ prefix (newer files)";
-        } else {
-            prefix = "b_";
-            qDebug() << "Using b_ prefix (newer files)";
-        }
-    } else if (testFileA.exists()) {
-        prefix = "a_";
-        qDebug() << "Found a_ files, using a_ prefix";
-    } else if (testFileB.exists()) {
-        prefix = "b_";
-        qDebug() << "Found b_ files, using b_ prefix";
-    } else {
-        // Fallback to a_ if no files exist
-        prefix = "a_";
-        qDebug() << "No prefix files found, using a_ prefix";
+    if (changedMonitors.empty()) {
+        qDebug() << "No wallpaper changed - skipping DBus call";
+        return finishedJob(enabledMonitors, true);
     }
+    qDebug() << changedMonitors.size() << "of" << enabledMonitors.size() << "monitor wallpaper(s) changed";
     
     // Build a simpler JavaScript script that works reliably
     QString script = QString(R"(
@@ -181,16 +181,12 @@ const ds = desktops();
 const enabledMonitors = [
 )");
     
-    // Add monitor geometry mappings
-    for (int i = 0; i < enabledMonitors.size(); ++i) {
-        const auto& monitor = enabledMonitors[i];
-        QString key = QString("'%1x%2+%3+%4'")
-            .arg(monitor.geometry.width())
-            .arg(monitor.geometry.height())
-            .arg(monitor.geometry.x())
-            .arg(monitor.geometry.y());
-        QString imagePath = QString("'file://%1/%2wallpaper_%3.jpg'")
-            .arg(outputDir).arg(prefix).arg(i);
+    // Add monitor geometry mappings; every monitor carries the path of its
+    // own split image
+    for (int i = 0; i < changedMonitors.size(); ++i) {
+        const auto& monitor = changedMonitors[i];
+        QString key = QString("'%1'").arg(monitorKey(monitor));
+        QString imagePath = QString("'file://%1'").arg(monitor.wallpaperPath);
         
         script += QString("  { key: %1, image: %2, index: %3 },\n")
             .arg(key).arg(imagePath).arg(i);
@@ -219,37 +215,167 @@ for (let i = 0; i < ds.length; i++) {
 )";
     
     qDebug() << "Executing DBus script to set wallpapers...";
-    qDebug() << "Using prefix:" << prefix;
     qDebug() << "Enabled monitors in order (left to right):";
     for (int i = 0; i < enabledMonitors.size(); ++i) {
         qDebug() << "  " << i << ":" << enabledMonitors[i].name 
                  << "at x=" << enabledMonitors[i].geometry.x()
                  << "y=" << enabledMonitors[i].geometry.y()
-                 << "size=" << enabledMonitors[i].geometry.width() << "x" << enabledMonitors[i].geometry.height();
+                 << "size=" << enabledMonitors[i].geometry.width() << "x" << enabledMonitors[i].geometry.height()
+                 << "->" << enabledMonitors[i].wallpaperPath;
     }
     
-    // Execute the script via DBus
-    QProcess process;
-    process.start("qdbus", QStringList() << "org.kde.plasmashell" << "/PlasmaShell" 
-                 << "org.kde.PlasmaShell.evaluateScript" << script);
+    // Execute the script via DBus. A desktop that last showed one image on
+    // every screen no longer does, so that entry goes.
+    ApplyJob* job = startScriptJob(enabledMonitors, script);
+    job->m_appliedState = appliedState;
+    job->m_appliedState.insert("*", QByteArray());
+    return job;
+}
+
+ApplyJob* WallpaperApplier::startScriptJob(const MonitorList& monitors, const QString& script)
+{
+    ApplyJob* job = new ApplyJob(monitors, this);
+    
+    // The bus enforces the timeout and reports it as an error reply
+    QDBusPendingCallWatcher* watcher = new QDBusPendingCallWatcher(runScript(script), job);
+    connect(watcher, &QDBusPendingCallWatcher::finished, job, [this, job](QDBusPendingCallWatcher* call) {
+        QDBusPendingReply<QString> reply = *call;
+        if (reply.isError()) {
+            qWarning() << "Failed to execute DBus script:" << reply.error().message();
+            finishJob(job, false, reply.error().message());
+            return;
+        }
+        
+        job->m_output = reply.value();
+        qDebug() << "Successfully executed DBus script to set wallpapers";
+        qDebug() << "Script output:" << job->m_output;
+        finishJob(job, true);
+    });
+    return job;
+}
+
+QDBusPendingCall WallpaperApplier::runScript(const QString& script)
+{
+    return PlasmaShell::evaluateScript(script, m_timeout);
+}
+
+ApplyJob* WallpaperApplier::startJob(const MonitorList& monitors,
+                                     const QString& program,
+                                     const QStringList& arguments)
+{
+    ApplyJob* job = new ApplyJob(monitors, this);
+    QProcess* process = new QProcess(job);
+    QTimer* timer = new QTimer(job);
+    timer->setSingleShot(true);
+    
+    // Everything below runs from the event loop; whichever of exit, start
+    // failure or timeout comes first decides the job
+    connect(process, &QProcess::finished, job,
+            [this, job, process, program](int exitCode, QProcess::ExitStatus exitStatus) {
+        if (job->isFinished()) {
+            return;
+        }
+        if (exitStatus != QProcess::NormalExit || exitCode != 0) {
+            QString error = QString::fromUtf8(process->readAllStandardError()).trimmed();
+            if (error.isEmpty()) {
+                error = QString("%1 exited with code %2").arg(program).arg(exitCode);
+            }
+            qWarning() << "Failed to apply wallpapers:" << error;
+            finishJob(job, false, error);
+            return;
+        }
+        
+        job->m_output = QString::fromUtf8(process->readAllStandardOutput());
+        qDebug() << "Successfully applied wallpapers with" << program;
+        qDebug() << "Script output:" << job->m_output;
+        finishJob(job, true);
+    });
+    connect(process, &QProcess::errorOccurred, job, [this, job, process, program](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart && !job->isFinished()) {
+            qWarning() << "Cannot run" << program << ":" << process->errorString();
+            finishJob(job, false, process->errorString());
+        }
+    });
+    connect(timer, &QTimer::timeout, job, [this, job, process, program]() {
+        if (job->isFinished()) {
+            return;
+        }
+        qWarning() << "Timeout waiting for" << program;
+        process->kill();
+        finishJob(job, false, "Timeout applying wallpaper");
+    });
     
-    if (!process.waitForFinished(10000)) { // 10 second timeout
-        qWarning() << "Timeout executing DBus script";
-        return false;
+    process->start(program, arguments);
+    timer->start(m_timeout);
+    return job;
+}
+
+ApplyJob* WallpaperApplier::finishedJob(const MonitorList& monitors, bool success, const QString& error)
+{
+    ApplyJob* job = new ApplyJob(monitors, this);
+    QTimer::singleShot(0, job, [this, job, success, error]() {
+        finishJob(job, success, error);
+    });
+    return job;
+}
+
+QByteArray WallpaperApplier::wallpaperIdentity(const QString& path)
+{
+    // Split outputs are content-addressed, so their path names the pixels.
+    // Their modification time is the cache's LRU order and changes on
+    // every cache hit, so it must not count as a change.
+    QFileInfo fileInfo(path);
+    if (SplitCache::isCacheFileName(fileInfo.fileName())) {
+        return fileInfo.absoluteFilePath().toUtf8();
     }
+    return SplitCache::fileFingerprint(path);
+}
+
+QString WallpaperApplier::monitorKey(const MonitorInfo& monitor)
+{
+    return QString("%1x%2+%3+%4")
+        .arg(monitor.geometry.width())
+        .arg(monitor.geometry.height())
+        .arg(monitor.geometry.x())
+        .arg(monitor.geometry.y());
+}
+
+void WallpaperApplier::finishJob(ApplyJob* job, bool success, const QString& error)
+{
+    job->m_finished = true;
+    job->m_success = success;
+    job->m_error = error;
     
-    if (process.exitCode() != 0) {
-        QString error = QString::fromUtf8(process.readAllStandardError());
-        qWarning() << "Failed to execute DBus script:" << error;
-        return false;
+    // After a failure it is unknown what the desktops show, so the next
+    // apply reconfigures every one of them
+    if (!success) {
+        m_appliedWallpapers.clear();
+    } else {
+        if (job->m_replacesAppliedState) {
+            m_appliedWallpapers.clear();
+        }
+        for (auto it = job->m_appliedState.cbegin(); it != job->m_appliedState.cend(); ++it) {
+            if (it.value().isEmpty()) {
+                m_appliedWallpapers.remove(it.key());
+            } else {
+                m_appliedWallpapers.insert(it.key(), it.value());
+            }
+        }
     }
     
-    qDebug() << "Successfully executed DBus script to set wallpapers";
-    qDebug() << "Script output:" << QString::fromUtf8(process.readAllStandardOutput());
+    for (const auto& monitor : job->monitors()) {
+        if (success) {
+            emit wallpaperApplied(monitor, monitor.wallpaperPath);
+        } else {
+            emit wallpaperFailed(monitor, error);
+        }
+    }
     
-    return true;
+    emit job->finished(success);
+    job->deleteLater();
 }
 
+
 QString WallpaperApplier::getCurrentWallpaper(const MonitorInfo& monitor)
 {
     // For KDE Plasma, we can read the wallpaper from the config
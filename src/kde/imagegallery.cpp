@@ -217,6 +217,31 @@ bool ImageGallery::hasImages() const
     return !m_imagePaths.isEmpty();
 }
 
+QStringList ImageGallery::neighbouringImages(int ahead, int behind) const
+{
+    QStringList images;
+    int count = m_imagePaths.size();
+    if (count < 2 || m_currentIndex < 0) {
+        return images;
+    }
+    
+    // Same wrap-around order as nextImage() and previousImage()
+    for (int i = 1; i <= ahead && i < count; ++i) {
+        QString imagePath = m_imagePaths[(m_currentIndex + i) % count];
+        if (!images.contains(imagePath)) {
+            images << imagePath;
+        }
+    }
+    for (int i = 1; i <= behind && i < count; ++i) {
+        QString imagePath = m_imagePaths[(m_currentIndex - i + count) % count];
+        if (!images.contains(imagePath)) {
+            images << imagePath;
+        }
+    }
+    
+    return images;
+}
+
 void ImageGallery::addImage()
 {
     QStringList fileNames = QFileDialog::getOpenFileNames(this,
@@ -254,6 +279,8 @@ void ImageGallery::addImage()
     }
     
     saveImages();
+    
+    emit imagesChanged();
 }
 
 void ImageGallery::removeImage(const QString& imagePath)
@@ -285,9 +312,13 @@ void ImageGallery::removeImage(const QString& imagePath)
                 m_currentIndex = -1;
                 emit imageSelected(QString());
             }
+        } else {
+            m_currentIndex = m_imagePaths.indexOf(m_currentImage);
         }
         
         saveImages();
+        
+        emit imagesChanged();
     }
 }
 
@@ -52,6 +52,10 @@ public:
     void setCurrentImage(const QString& imagePath);
     QStringList getAllImages() const;
     bool hasImages() const;
+    
+    // Images that Next (ahead) and Previous (behind) will select from the
+    // current one, nearest first
+    QStringList neighbouringImages(int ahead, int behind) const;
 
 public slots:
     void addImage();
@@ -69,6 +73,7 @@ public:
 signals:
     void imageSelected(const QString& imagePath);
     void autoChangeToggled(bool enabled);
+    void imagesChanged();
 
 private slots:
     void onTimerTimeout();
@@ -7,6 +7,7 @@
 #include <KLocalizedString>
 #include <KAboutData>
 #include "mainwindow.h"
+#include "core/image_splitter.h"
 
 int main(int argc, char *argv[])
 {
@@ -37,6 +38,9 @@ int main(int argc, char *argv[])
     
     KLocalizedString::setApplicationDomain("wallpaper-splitter");
     
+    // Let Qt decode sources up to the splitter's memory limit in one piece
+    WallpaperCore::ImageSplitter::raiseQtAllocationLimit(WallpaperCore::ImageSplitter::DefaultMemoryLimit);
+    
     KAboutData aboutData(
         QStringLiteral("wallpaper-splitter-kde"),
         i18n("Wallpaper Splitter"),
@@ -6,6 +6,7 @@
 #include <QIcon>
 #include <QFileDialog>
 #include <QFileInfo>
+#include <QSignalBlocker>
 #include <KLocalizedString>
 #include <KMessageBox>
 
@@ -14,12 +15,19 @@ MainWindow::MainWindow(QWidget* parent)
     , m_monitorDetector(nullptr)
     , m_imageSplitter(nullptr)
     , m_wallpaperApplier(nullptr)
+    , m_splitPrefetcher(nullptr)
+    , m_layoutProfiles(nullptr)
     , m_autoChangeEnabled(false)
+    , m_prefetchCount(2)
+    , m_applyQueued(false)
 {
     // Initialize core components
     m_monitorDetector = new WallpaperCore::MonitorDetector(this);
     m_imageSplitter = new WallpaperCore::ImageSplitter();
     m_wallpaperApplier = new WallpaperCore::WallpaperApplier(this);
+    m_splitPrefetcher = new WallpaperCore::SplitPrefetcher(this);
+    m_layoutProfiles = new WallpaperCore::LayoutProfileStore(
+        QStandardPaths::writableLocation(QStandardPaths::ConfigLocation) + "/wallpaper-splitter/profiles.conf");
     
     // Setup output directory - use writable location in Flatpak or next to executable
     QString appDir = QCoreApplication::applicationDirPath();
@@ -46,6 +54,8 @@ MainWindow::MainWindow(QWidget* parent)
             this, &MainWindow::onImageSelected);
     connect(m_imageGallery, &ImageGallery::autoChangeToggled,
             this, &MainWindow::onAutoChangeToggled);
+    connect(m_imageGallery, &ImageGallery::imagesChanged,
+            this, &MainWindow::schedulePrefetch);
     
     // Setup system tray
     setupSystemTray();
@@ -70,7 +80,13 @@ MainWindow::~MainWindow()
 {
     // Save monitor states before destruction
     saveMonitorStates();
+    
+    // Let a background split finish before its settings source goes away
+    m_splitPrefetcher->cancel();
+    delete m_splitPrefetcher;
+    m_splitPrefetcher = nullptr;
     delete m_imageSplitter;
+    delete m_layoutProfiles;
 }
 
 void MainWindow::setupUI()
@@ -101,8 +117,29 @@ void MainWindow::setupUI()
     m_refreshMonitorsButton = new QPushButton(i18n("Refresh Monitors"), this);
     m_applyButton = new QPushButton(i18n("Apply Wallpapers"), this);
     
+    // Number of monitors split in parallel (0 = one per CPU core)
+    QLabel* splitThreadsLabel = new QLabel(i18n("Split threads:"), this);
+    m_splitThreadsSpinBox = new QSpinBox(this);
+    m_splitThreadsSpinBox->setRange(0, 64);
+    m_splitThreadsSpinBox->setSpecialValueText(i18n("Auto"));
+    m_splitThreadsSpinBox->setToolTip(i18n("Number of monitors processed in parallel when splitting"));
+    
+    // File format of the split images
+    QLabel* outputFormatLabel = new QLabel(i18n("Output format:"), this);
+    m_outputFormatComboBox = new QComboBox(this);
+    m_outputFormatComboBox->addItem(i18n("JPEG"), static_cast<int>(WallpaperCore::OutputFormat::Jpeg));
+    m_outputFormatComboBox->addItem(i18n("PNG (fast)"), static_cast<int>(WallpaperCore::OutputFormat::Png));
+    m_outputFormatComboBox->addItem(i18n("BMP (uncompressed)"), static_cast<int>(WallpaperCore::OutputFormat::Bmp));
+    m_outputFormatComboBox->addItem(i18n("PPM (uncompressed)"), static_cast<int>(WallpaperCore::OutputFormat::Ppm));
+    m_outputFormatComboBox->addItem(i18n("QOI"), static_cast<int>(WallpaperCore::OutputFormat::Qoi));
+    m_outputFormatComboBox->setToolTip(i18n("Uncompressed and QOI images use more disk space but are much faster to write"));
+    
     m_topLayout->addWidget(m_refreshMonitorsButton);
     m_topLayout->addStretch();
+    m_topLayout->addWidget(outputFormatLabel);
+    m_topLayout->addWidget(m_outputFormatComboBox);
+    m_topLayout->addWidget(splitThreadsLabel);
+    m_topLayout->addWidget(m_splitThreadsSpinBox);
     m_topLayout->addWidget(m_applyButton);
     
     m_mainLayout->addLayout(m_topLayout);
@@ -121,8 +158,14 @@ void MainWindow::setupUI()
     m_mainLayout->addWidget(m_imagePreview, 1); // Give it more space
     
     // Connect signals
-    connect(m_refreshMonitorsButton, &QPushButton::clicked, this, &MainWindow::refreshMonitors);
+    // Re-reads the screens; the result arrives through monitorsChanged()
+    connect(m_refreshMonitorsButton, &QPushButton::clicked,
+            m_monitorDetector, &WallpaperCore::MonitorDetector::refreshMonitors);
     connect(m_applyButton, &QPushButton::clicked, this, &MainWindow::applyWallpapers);
+    connect(m_splitThreadsSpinBox, QOverload<int>::of(&QSpinBox::valueChanged),
+            this, &MainWindow::onSplitThreadsChanged);
+    connect(m_outputFormatComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &MainWindow::onOutputFormatChanged);
     
     // Initial state
     m_applyButton->setEnabled(false);
@@ -136,28 +179,49 @@ void MainWindow::refreshMonitors()
     QVector<bool> oldMonitorEnabled = m_monitorEnabled;
     
     m_monitors = m_monitorDetector->detectMonitors();
+    QString layoutKey = WallpaperCore::LayoutProfileStore::layoutKey(m_monitors);
     
-    // Preserve enabled state for existing monitors, enable new ones by default
     m_monitorEnabled.clear();
-    for (int i = 0; i < m_monitors.size(); ++i) {
-        // If this monitor index existed before, preserve its state
-        if (i < oldMonitorEnabled.size()) {
-            m_monitorEnabled.append(oldMonitorEnabled[i]);
-        } else {
-            // New monitor, enable by default
-            m_monitorEnabled.append(true);
+    if (layoutKey != m_layoutKey && m_layoutProfiles->contains(layoutKey)) {
+        // A layout seen before gets back the monitors that were enabled on it
+        m_monitorEnabled = m_layoutProfiles->profile(layoutKey).enabled;
+    } else {
+        // Preserve enabled state for existing monitors, enable new ones by default
+        for (int i = 0; i < m_monitors.size(); ++i) {
+            // If this monitor index existed before, preserve its state
+            if (i < oldMonitorEnabled.size()) {
+                m_monitorEnabled.append(oldMonitorEnabled[i]);
+            } else {
+                // New monitor, enable by default
+                m_monitorEnabled.append(true);
+            }
         }
     }
     
+    // Remember this layout as a profile
+    m_layoutKey = m_layoutProfiles->remember(m_monitors, m_monitorEnabled);
+    
     // Save the updated monitor states after refresh
     saveMonitorStates();
     
     updateImagePreview();
-    m_applyButton->setEnabled(!m_selectedImagePath.isEmpty() && !m_monitors.empty());
+    updateApplyButton();
+    
+    // Splits prepared for the old layout no longer match
+    schedulePrefetch();
 }
 
 void MainWindow::applyWallpapers()
 {
+    // One apply at a time, so two jobs never race on the desktops. A request
+    // while one runs (a new gallery image, the timer, a dock) is applied once
+    // it finishes, with whatever is selected then.
+    if (m_applyJob) {
+        qDebug() << "Wallpapers are being applied - applying again when done";
+        m_applyQueued = true;
+        return;
+    }
+    
     if (m_selectedImagePath.isEmpty() || m_monitors.empty()) {
         // Don't show popup for auto-change, just log and return
         qDebug() << "Cannot apply wallpapers: No image selected or no monitors detected";
@@ -176,7 +240,7 @@ void MainWindow::applyWallpapers()
     m_progressBar->setValue(0);
     m_applyButton->setEnabled(false);
     
-    bool success = false;
+    WallpaperCore::MonitorList appliedMonitors;
     
     // Check if we have only one monitor - if so, apply the image directly without splitting
     if (enabledMonitors.size() == 1) {
@@ -187,30 +251,49 @@ void MainWindow::applyWallpapers()
         enabledMonitors[0].wallpaperPath = m_selectedImagePath;
         
         // Apply wallpaper directly
-        success = m_wallpaperApplier->applyWallpapers(enabledMonitors);
+        appliedMonitors = enabledMonitors;
     } else {
         // Multiple monitors - split the image as before
         qDebug() << "Multiple monitors detected - splitting image for" << enabledMonitors.size() << "monitors";
         
+        // If the background prefetcher is splitting this image right now,
+        // stop it; this split uses every thread
+        m_splitPrefetcher->waitFor(m_selectedImagePath, enabledMonitors);
+        
         // Split the image
-        if (!m_imageSplitter->splitImage(m_selectedImagePath, enabledMonitors, m_outputDir)) {
+        bool splitOk = m_imageSplitter->splitImage(m_selectedImagePath, enabledMonitors, m_outputDir);
+        for (const auto& result : m_imageSplitter->lastResults()) {
+            qDebug() << "Split for monitor" << result.monitor.name
+                     << (result.success ? "succeeded:" : "failed:") << result.outputPath;
+        }
+        
+        if (!splitOk) {
             KMessageBox::error(this, i18n("Failed to split image for monitors."));
             m_progressBar->setVisible(false);
-            m_applyButton->setEnabled(true);
+            updateApplyButton();
             return;
         }
         
-        // Set wallpaper paths for each monitor to use individual split images with index-based naming
-        for (size_t i = 0; i < enabledMonitors.size(); ++i) {
-            enabledMonitors[i].wallpaperPath = m_outputDir + QString("/wallpaper_%1.jpg").arg(i);
-        }
-        
-        // Apply wallpapers
-        success = m_wallpaperApplier->applyWallpapers(enabledMonitors);
+        // Apply wallpapers, each monitor pointing at its own split image.
+        // Background splits must not evict it while it is on screen.
+        appliedMonitors = m_imageSplitter->lastOutputMonitors();
+        m_splitPrefetcher->setKeepKey(m_imageSplitter->lastCacheKey());
     }
     
+    // Plasma applies the wallpapers while the window stays responsive;
+    // onApplyFinished() wraps up
+    m_applyJob = m_wallpaperApplier->applyWallpapersAsync(appliedMonitors);
+    connect(m_applyJob, &WallpaperCore::ApplyJob::finished, this, &MainWindow::onApplyFinished);
+    
+    // Get the next images ready while the timer runs
+    schedulePrefetch();
+}
+
+void MainWindow::onApplyFinished(bool success)
+{
+    m_applyJob = nullptr;
     m_progressBar->setVisible(false);
-    m_applyButton->setEnabled(true);
+    updateApplyButton();
     
     // Log the result to console instead of showing popup
     if (success) {
@@ -218,11 +301,29 @@ void MainWindow::applyWallpapers()
     } else {
         qWarning() << "Some wallpapers failed to apply. Check the console for details.";
     }
+    
+    if (m_applyQueued) {
+        m_applyQueued = false;
+        applyWallpapers();
+    }
 }
 
 void MainWindow::onMonitorsChanged()
 {
+    QString previousLayout = m_layoutKey;
     refreshMonitors();
+    
+    // On a dock or undock, switch to this layout's split right away. For a
+    // known profile it was prepared in the background, so this is a cache
+    // lookup and the DBus call.
+    if (m_layoutKey != previousLayout) {
+        // Desktops may have been recreated or remapped to other screens
+        m_wallpaperApplier->forgetAppliedWallpapers();
+    }
+    if (m_layoutKey != previousLayout && !m_selectedImagePath.isEmpty() && !m_monitors.empty()) {
+        qDebug() << "Monitor layout changed to" << m_layoutKey << "- applying wallpaper";
+        applyWallpapers();
+    }
 }
 
 void MainWindow::onWallpaperApplied(const WallpaperCore::MonitorInfo& monitor, const QString& path)
@@ -237,14 +338,30 @@ void MainWindow::onWallpaperFailed(const WallpaperCore::MonitorInfo& monitor, co
     qWarning() << "Failed to apply wallpaper to monitor" << monitor.name << ":" << error;
 }
 
+void MainWindow::onSplitThreadsChanged(int threads)
+{
+    m_imageSplitter->setThreadCount(threads);
+    saveApplicationState();
+}
+
+void MainWindow::onOutputFormatChanged(int index)
+{
+    int format = m_outputFormatComboBox->itemData(index).toInt();
+    m_imageSplitter->setOutputFormat(static_cast<WallpaperCore::OutputFormat>(format));
+    saveApplicationState();
+    schedulePrefetch();
+}
+
 void MainWindow::onMonitorToggled(int monitorIndex, bool enabled)
 {
     if (monitorIndex >= 0 && monitorIndex < m_monitorEnabled.size()) {
         m_monitorEnabled[monitorIndex] = enabled;
-        m_applyButton->setEnabled(!m_selectedImagePath.isEmpty() && getEnabledMonitors().size() > 0);
+        updateApplyButton();
         
         // Save the updated monitor states
         saveMonitorStates();
+        m_layoutProfiles->remember(m_monitors, m_monitorEnabled);
+        schedulePrefetch();
     }
 }
 
@@ -263,6 +380,12 @@ void MainWindow::updateImagePreview()
     m_imagePreview->setMonitors(m_monitors, m_monitorEnabled);
 }
 
+void MainWindow::updateApplyButton()
+{
+    // Stays disabled while an apply runs; see applyWallpapers()
+    m_applyButton->setEnabled(!m_applyJob && !m_selectedImagePath.isEmpty() && !getEnabledMonitors().empty());
+}
+
 WallpaperCore::MonitorList MainWindow::getEnabledMonitors() const
 {
     WallpaperCore::MonitorList enabledMonitors;
@@ -341,7 +464,7 @@ void MainWindow::onImageSelected(const QString& imagePath)
 {
     m_selectedImagePath = imagePath;
     updateImagePreview();
-    m_applyButton->setEnabled(!imagePath.isEmpty() && !m_monitors.empty());
+    updateApplyButton();
     
     // If auto-change is enabled, automatically apply the new wallpaper
     if (m_autoChangeEnabled && !imagePath.isEmpty() && !m_monitors.empty()) {
@@ -418,6 +541,13 @@ void MainWindow::saveApplicationState()
     
     // Save selected image path
     settings.setValue("image/selectedPath", m_selectedImagePath);
+    
+    // Save split thread count
+    settings.setValue("split/threads", m_splitThreadsSpinBox->value());
+    
+    // Save output format
+    settings.setValue("split/format",
+                      WallpaperCore::ImageEncoder::formatName(m_imageSplitter->outputFormat()));
 }
 
 void MainWindow::loadApplicationState()
@@ -430,4 +560,68 @@ void MainWindow::loadApplicationState()
     
     // Load selected image path
     m_selectedImagePath = settings.value("image/selectedPath", "").toString();
+    
+    // Load split thread count (blocked so restoring it doesn't re-save the config)
+    int splitThreads = settings.value("split/threads", 0).toInt();
+    QSignalBlocker blocker(m_splitThreadsSpinBox);
+    m_splitThreadsSpinBox->setValue(splitThreads);
+    m_imageSplitter->setThreadCount(splitThreads);
+    
+    // Load output format
+    WallpaperCore::OutputFormat outputFormat = WallpaperCore::OutputFormat::Jpeg;
+    WallpaperCore::ImageEncoder::parseFormat(settings.value("split/format", "jpeg").toString(), &outputFormat);
+    QSignalBlocker formatBlocker(m_outputFormatComboBox);
+    m_outputFormatComboBox->setCurrentIndex(m_outputFormatComboBox->findData(static_cast<int>(outputFormat)));
+    m_imageSplitter->setOutputFormat(outputFormat);
+    
+    // Load the decoded source cache size, which makes re-splits after a
+    // monitor toggle or layout change skip the decode (0 = off, the default)
+    qint64 decodedCacheMb = qMax<qint64>(0, settings.value("cache/decodedMb", 0).toLongLong());
+    m_imageSplitter->setDecodedCacheLimit(decodedCacheMb << 20);
+    
+    // Load how many upcoming images are split in the background (0 = off)
+    m_prefetchCount = qBound(0, settings.value("prefetch/count", 2).toInt(), 16);
+}
+
+void MainWindow::schedulePrefetch()
+{
+    if (!m_splitPrefetcher) {
+        return;
+    }
+    
+    QList<WallpaperCore::PrefetchJob> jobs;
+    
+    // The current image for every other known layout first, so a dock or
+    // undock can switch wallpapers without splitting on the spot. Layouts
+    // with a single enabled monitor use the source image directly.
+    if (!m_selectedImagePath.isEmpty()) {
+        for (const WallpaperCore::LayoutProfile& profile : m_layoutProfiles->profiles()) {
+            WallpaperCore::MonitorList profileMonitors = profile.enabledMonitors();
+            if (profile.key != m_layoutKey && profileMonitors.size() >= 2) {
+                jobs.append(WallpaperCore::PrefetchJob{m_selectedImagePath, profileMonitors});
+            }
+        }
+    }
+    
+    // Then the next images for this layout, and the previous one for the
+    // Previous button
+    WallpaperCore::MonitorList enabledMonitors = getEnabledMonitors();
+    if (m_prefetchCount > 0 && enabledMonitors.size() >= 2) {
+        QStringList upcoming = m_imageGallery->neighbouringImages(m_prefetchCount, 1);
+        upcoming.removeAll(m_selectedImagePath);
+        for (const QString& imagePath : upcoming) {
+            jobs.append(WallpaperCore::PrefetchJob{imagePath, enabledMonitors});
+        }
+    }
+    
+    if (jobs.isEmpty()) {
+        m_splitPrefetcher->cancel();
+        return;
+    }
+    
+    // Keep background writes well inside the split cache so prefetching
+    // never evicts the wallpaper that is currently shown
+    m_splitPrefetcher->setSplitterSettings(*m_imageSplitter);
+    m_splitPrefetcher->setDiskBudget(m_imageSplitter->cacheLimit() / 2);
+    m_splitPrefetcher->prefetch(jobs, m_outputDir);
 } 
\ No newline at end of file
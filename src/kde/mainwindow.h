@@ -6,14 +6,19 @@
 #include <QPushButton>
 #include <QLabel>
 #include <QProgressBar>
+#include <QSpinBox>
+#include <QComboBox>
 #include <QScrollArea>
 #include <QVector>
 #include <QSystemTrayIcon>
 #include <QMenu>
+#include <QPointer>
 #include <QCloseEvent>
 #include <QSettings>
 #include "core/monitor_detector.h"
 #include "core/image_splitter.h"
+#include "core/layout_profiles.h"
+#include "core/split_prefetcher.h"
 #include "core/wallpaper_applier.h"
 #include "core/monitor_info.h"
 #include "imagepreview.h"
@@ -29,12 +34,15 @@ public:
 private slots:
     void refreshMonitors();
     void applyWallpapers();
+    void onApplyFinished(bool success);
     void onMonitorsChanged();
     void onWallpaperApplied(const WallpaperCore::MonitorInfo& monitor, const QString& path);
     void onWallpaperFailed(const WallpaperCore::MonitorInfo& monitor, const QString& error);
     void onMonitorToggled(int monitorIndex, bool enabled);
     void onImageSelected(const QString& imagePath);
     void onAutoChangeToggled(bool enabled);
+    void onSplitThreadsChanged(int threads);
+    void onOutputFormatChanged(int index);
 
 private:
     void setupUI();
@@ -46,11 +54,15 @@ private:
     void loadMonitorStates();
     void saveApplicationState();
     void loadApplicationState();
+    void schedulePrefetch();
+    void updateApplyButton();
 
     // Core components
     WallpaperCore::MonitorDetector* m_monitorDetector;
     WallpaperCore::ImageSplitter* m_imageSplitter;
     WallpaperCore::WallpaperApplier* m_wallpaperApplier;
+    WallpaperCore::SplitPrefetcher* m_splitPrefetcher;
+    WallpaperCore::LayoutProfileStore* m_layoutProfiles;
 
     // UI components
     QWidget* m_centralWidget;
@@ -58,6 +70,8 @@ private:
     QHBoxLayout* m_topLayout;
     QPushButton* m_refreshMonitorsButton;
     QPushButton* m_applyButton;
+    QSpinBox* m_splitThreadsSpinBox;
+    QComboBox* m_outputFormatComboBox;
     QProgressBar* m_progressBar;
     ImagePreview* m_imagePreview;
     ImageGallery* m_imageGallery;
@@ -67,7 +81,11 @@ private:
     QString m_outputDir;
     WallpaperCore::MonitorList m_monitors;
     QVector<bool> m_monitorEnabled; // Track which monitors are enabled
+    QString m_layoutKey; // Profile key of the connected monitor layout
     bool m_autoChangeEnabled; // Track if auto-change is enabled
+    int m_prefetchCount; // Upcoming gallery images split in the background
+    QPointer<WallpaperCore::ApplyJob> m_applyJob; // Apply running in Plasma, if any
+    bool m_applyQueued; // Apply again once m_applyJob finishes
     
     // System tray
     QSystemTrayIcon* m_systemTray;
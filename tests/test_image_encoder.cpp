@@ -0,0 +1,136 @@
+#include <QBuffer>
+#include <QTest>
+#include "core/image_encoder.h"
+#include <cstring>
+
+namespace {
+
+// Straight transcription of the decoder in the QOI specification
+// (https://qoiformat.org/qoi-specification.pdf), kept independent of the
+// encoder on purpose. Returns ARGB32 pixels.
+QImage decodeQoiReference(const QByteArray& data)
+{
+    const uchar* bytes = reinterpret_cast<const uchar*>(data.constData());
+    const qsizetype size = data.size();
+    if (size < 22 || memcmp(bytes, "qoif", 4) != 0) {
+        return QImage();
+    }
+
+    auto readBigEndian32 = [bytes](int offset) {
+        return quint32(bytes[offset]) << 24 | quint32(bytes[offset + 1]) << 16 |
+               quint32(bytes[offset + 2]) << 8 | quint32(bytes[offset + 3]);
+    };
+    const int width = int(readBigEndian32(4));
+    const int height = int(readBigEndian32(8));
+
+    QImage image(width, height, QImage::Format_ARGB32);
+    uchar index[64][4] = {};
+    uchar pixel[4] = {0, 0, 0, 255};
+    qsizetype p = 14;
+    int run = 0;
+
+    for (int y = 0; y < height; ++y) {
+        QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < width; ++x) {
+            if (run > 0) {
+                --run;
+            } else if (p < size - 8) {
+                const uchar b1 = bytes[p++];
+                if (b1 == 0xfe) {
+                    pixel[0] = bytes[p++];
+                    pixel[1] = bytes[p++];
+                    pixel[2] = bytes[p++];
+                } else if (b1 == 0xff) {
+                    pixel[0] = bytes[p++];
+                    pixel[1] = bytes[p++];
+                    pixel[2] = bytes[p++];
+                    pixel[3] = bytes[p++];
+                } else if ((b1 & 0xc0) == 0x00) {
+                    memcpy(pixel, index[b1], 4);
+                } else if ((b1 & 0xc0) == 0x40) {
+                    pixel[0] += ((b1 >> 4) & 0x03) - 2;
+                    pixel[1] += ((b1 >> 2) & 0x03) - 2;
+                    pixel[2] += (b1 & 0x03) - 2;
+                } else if ((b1 & 0xc0) == 0x80) {
+                    const uchar b2 = bytes[p++];
+                    const int vg = (b1 & 0x3f) - 32;
+                    pixel[0] += vg - 8 + ((b2 >> 4) & 0x0f);
+                    pixel[1] += vg;
+                    pixel[2] += vg - 8 + (b2 & 0x0f);
+                } else {
+                    run = b1 & 0x3f;
+                }
+                memcpy(index[(pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + pixel[3] * 11) % 64], pixel, 4);
+            }
+            line[x] = qRgba(pixel[0], pixel[1], pixel[2], pixel[3]);
+        }
+    }
+    return image;
+}
+
+QImage roundTrip(const QImage& image)
+{
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    if (!WallpaperCore::ImageEncoder::writeQoi(image, &buffer)) {
+        return QImage();
+    }
+    return decodeQoiReference(buffer.data());
+}
+
+QImage noiseImage(const QSize& size, QImage::Format format, quint32 seed)
+{
+    QImage image(size, format);
+    for (int y = 0; y < size.height(); ++y) {
+        QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < size.width(); ++x) {
+            seed = seed * 1664525u + 1013904223u;
+            // Mostly small steps so every chunk type shows up, plus repeats
+            QRgb value = (x % 7 == 0 && x > 0) ? line[x - 1] : QRgb(seed >> 3);
+            line[x] = format == QImage::Format_ARGB32 ? value : (value | 0xff000000u);
+        }
+    }
+    return image;
+}
+
+} // namespace
+
+class TestImageEncoder : public QObject {
+    Q_OBJECT
+
+private slots:
+    void qoiOpaqueBlack();
+    void qoiOpaque();
+    void qoiAlpha();
+};
+
+void TestImageEncoder::qoiOpaqueBlack()
+{
+    // Opaque black after another colour hashes to a slot the index must
+    // not hold yet
+    QImage image(4, 2, QImage::Format_RGB32);
+    image.fill(Qt::black);
+    image.setPixel(0, 0, qRgb(255, 0, 0));
+    image.setPixel(2, 1, qRgb(0, 0, 255));
+
+    QImage decoded = roundTrip(image);
+    QVERIFY(!decoded.isNull());
+    QCOMPARE(decoded, image.convertToFormat(QImage::Format_ARGB32));
+}
+
+void TestImageEncoder::qoiOpaque()
+{
+    QImage image = noiseImage(QSize(67, 31), QImage::Format_RGB32, 1);
+    QCOMPARE(roundTrip(image), image.convertToFormat(QImage::Format_ARGB32));
+}
+
+void TestImageEncoder::qoiAlpha()
+{
+    QImage image = noiseImage(QSize(53, 29), QImage::Format_ARGB32, 2);
+    image.setPixel(0, 0, qRgba(0, 0, 0, 0));
+    image.setPixel(1, 0, qRgba(0, 0, 0, 255));
+    QCOMPARE(roundTrip(image), image);
+}
+
+QTEST_GUILESS_MAIN(TestImageEncoder)
+#include "test_image_encoder.moc"
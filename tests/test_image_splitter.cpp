@@ -0,0 +1,116 @@
+#include <QImage>
+#include <QTemporaryDir>
+#include <QTest>
+#include "core/image_splitter.h"
+
+using WallpaperCore::ImageSplitter;
+using WallpaperCore::MonitorInfo;
+using WallpaperCore::MonitorList;
+using WallpaperCore::ResampleFilter;
+
+Q_DECLARE_METATYPE(WallpaperCore::ResampleFilter)
+Q_DECLARE_METATYPE(WallpaperCore::MonitorList)
+
+namespace {
+
+MonitorInfo makeMonitor(const QString& name, const QRect& geometry)
+{
+    MonitorInfo monitor;
+    monitor.name = name;
+    monitor.geometry = geometry;
+    monitor.actualResolution = geometry.size();
+    return monitor;
+}
+
+// Smooth gradients with some noise, so every filter tap matters
+QImage sourceImage(const QSize& size)
+{
+    QImage image(size, QImage::Format_RGB32);
+    quint32 seed = 1;
+    for (int y = 0; y < size.height(); ++y) {
+        QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < size.width(); ++x) {
+            seed = seed * 1664525u + 1013904223u;
+            int noise = int(seed >> 28);
+            line[x] = qRgb((x * 255 / size.width() + noise) & 0xff,
+                           (y * 255 / size.height() + noise) & 0xff,
+                           ((x + y) / 5 + noise) & 0xff);
+        }
+    }
+    return image;
+}
+
+// Lossless outputs, full-size decodes and no region decode, so only the
+// memory limit decides between a full decode and streaming
+void configure(ImageSplitter& splitter, ResampleFilter filter, qint64 memoryLimit)
+{
+    splitter.setOutputFormat(WallpaperCore::OutputFormat::Png);
+    splitter.setResampleFilter(filter);
+    splitter.setScaledDecodeEnabled(false);
+    splitter.setRegionDecodeEnabled(false);
+    splitter.setThreadCount(1);
+    splitter.setMemoryLimit(memoryLimit);
+}
+
+} // namespace
+
+class TestImageSplitter : public QObject {
+    Q_OBJECT
+
+private slots:
+    void streamedMatchesFullDecode_data();
+    void streamedMatchesFullDecode();
+};
+
+void TestImageSplitter::streamedMatchesFullDecode_data()
+{
+    QTest::addColumn<ResampleFilter>("filter");
+    QTest::addColumn<MonitorList>("monitors");
+
+    // Odd widths, a vertical downscale and a slight horizontal upscale
+    MonitorList sideBySide{makeMonitor("DP-0", QRect(0, 0, 640, 400)),
+                           makeMonitor("DP-1", QRect(640, 0, 561, 400))};
+    // Different vertical scales, and source rows between the two crops
+    // that no output reads
+    MonitorList stacked{makeMonitor("DP-0", QRect(0, 0, 800, 280)),
+                        makeMonitor("DP-1", QRect(100, 380, 700, 300))};
+
+    const ResampleFilter filters[] = {ResampleFilter::Box, ResampleFilter::Bilinear, ResampleFilter::Lanczos3};
+    for (ResampleFilter filter : filters) {
+        QString name = WallpaperCore::Resampler::filterName(filter);
+        QTest::addRow("side by side %s", qPrintable(name)) << filter << sideBySide;
+        QTest::addRow("stacked %s", qPrintable(name)) << filter << stacked;
+    }
+}
+
+void TestImageSplitter::streamedMatchesFullDecode()
+{
+    QFETCH(ResampleFilter, filter);
+    QFETCH(MonitorList, monitors);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString sourcePath = dir.filePath("source.jpg");
+    QVERIFY(sourceImage(QSize(1203, 697)).save(sourcePath, "JPEG", 95));
+
+    ImageSplitter full;
+    configure(full, filter, 0);
+    QVERIFY(full.splitImage(sourcePath, monitors, dir.filePath("full")));
+
+    // 2.5 MB holds both outputs plus a stripe of under a hundred source
+    // rows, well below the 3.2 MB decoded source
+    ImageSplitter streamed;
+    configure(streamed, filter, qint64(5) << 19);
+    QVERIFY(streamed.splitImage(sourcePath, monitors, dir.filePath("streamed")));
+
+    QCOMPARE(streamed.lastResults().size(), full.lastResults().size());
+    for (size_t i = 0; i < full.lastResults().size(); ++i) {
+        QImage expected(full.lastResults()[i].outputPath);
+        QImage actual(streamed.lastResults()[i].outputPath);
+        QVERIFY(!expected.isNull());
+        QCOMPARE(actual.convertToFormat(QImage::Format_RGB32), expected.convertToFormat(QImage::Format_RGB32));
+    }
+}
+
+QTEST_GUILESS_MAIN(TestImageSplitter)
+#include "test_image_splitter.moc"
@@ -0,0 +1,180 @@
+#include <QTest>
+#include "core/resampler.h"
+#include <vector>
+
+using WallpaperCore::ResampleFilter;
+using WallpaperCore::Resampler;
+
+Q_DECLARE_METATYPE(WallpaperCore::ResampleFilter)
+
+namespace {
+
+std::vector<uchar> resample(const std::vector<uchar>& src, const QSize& srcSize, qsizetype srcStride,
+                            const QSize& dstSize, ResampleFilter filter, Resampler::Isa isa,
+                            bool premultiplied = false)
+{
+    std::vector<uchar> dst(size_t(dstSize.width()) * dstSize.height() * 4);
+    bool ok = Resampler::resample(src.data(), srcSize.width(), srcSize.height(), srcStride,
+                                  dst.data(), dstSize.width(), dstSize.height(), dstSize.width() * 4,
+                                  filter, isa, premultiplied);
+    return ok ? dst : std::vector<uchar>();
+}
+
+QByteArray bytes(const std::vector<uchar>& data)
+{
+    return QByteArray(reinterpret_cast<const char*>(data.data()), qsizetype(data.size()));
+}
+
+void addFilterRows(const char* name, const QSize& src, const QSize& dst)
+{
+    const ResampleFilter filters[] = {ResampleFilter::Box, ResampleFilter::Bilinear, ResampleFilter::Lanczos3};
+    for (ResampleFilter filter : filters) {
+        QTest::addRow("%s %s", name, qPrintable(Resampler::filterName(filter))) << src << dst << filter;
+    }
+}
+
+} // namespace
+
+class TestResampler : public QObject {
+    Q_OBJECT
+
+private slots:
+    void simdMatchesScalar_data();
+    void simdMatchesScalar();
+    void golden_data();
+    void golden();
+    void premultipliedEdge_data();
+    void premultipliedEdge();
+};
+
+void TestResampler::simdMatchesScalar_data()
+{
+    QTest::addColumn<QSize>("srcSize");
+    QTest::addColumn<QSize>("dstSize");
+    QTest::addColumn<ResampleFilter>("filter");
+
+    // Odd widths and heights leave partial vectors at the end of each row
+    addFilterRows("down", QSize(37, 23), QSize(17, 11));
+    addFilterRows("up", QSize(37, 23), QSize(61, 29));
+    addFilterRows("wide", QSize(255, 3), QSize(31, 17));
+    addFilterRows("tall", QSize(9, 65), QSize(7, 3));
+    addFilterRows("narrow", QSize(101, 7), QSize(3, 5));
+    addFilterRows("single pixel", QSize(1, 1), QSize(9, 5));
+    addFilterRows("same size", QSize(13, 9), QSize(13, 9));
+}
+
+void TestResampler::simdMatchesScalar()
+{
+    QFETCH(QSize, srcSize);
+    QFETCH(QSize, dstSize);
+    QFETCH(ResampleFilter, filter);
+
+    Resampler::Isa best = Resampler::detectIsa();
+    if (best == Resampler::Isa::Scalar) {
+        QSKIP("No SIMD kernels on this CPU or build");
+    }
+
+    // Padded rows, so strides differ from the row width
+    qsizetype srcStride = qsizetype(srcSize.width()) * 4 + 12;
+    std::vector<uchar> src(size_t(srcStride) * srcSize.height());
+    quint32 seed = quint32(srcSize.width() * 31 + srcSize.height());
+    for (uchar& value : src) {
+        seed = seed * 1664525u + 1013904223u;
+        value = uchar(seed >> 24);
+    }
+
+    for (bool premultiplied : {false, true}) {
+        QByteArray scalar = bytes(resample(src, srcSize, srcStride, dstSize, filter,
+                                           Resampler::Isa::Scalar, premultiplied));
+        QVERIFY(!scalar.isEmpty());
+        QCOMPARE(bytes(resample(src, srcSize, srcStride, dstSize, filter,
+                                Resampler::Isa::SSE41, premultiplied)), scalar);
+        if (best == Resampler::Isa::AVX2) {
+            QCOMPARE(bytes(resample(src, srcSize, srcStride, dstSize, filter,
+                                    Resampler::Isa::AVX2, premultiplied)), scalar);
+        }
+    }
+}
+
+void TestResampler::golden_data()
+{
+    QTest::addColumn<ResampleFilter>("filter");
+    QTest::addColumn<QByteArray>("expected");
+
+    // 5x3 -> 3x2, bytes in memory order
+    const uchar box[] = {30, 70, 110, 255, 120, 160, 200, 255, 210, 122, 34, 255,
+                         80, 120, 160, 255, 170, 210, 250, 255, 132, 44, 84, 255};
+    const uchar bilinear[] = {35, 75, 115, 255, 129, 169, 152, 255, 169, 117, 47, 255,
+                              67, 107, 147, 255, 161, 165, 184, 255, 109, 80, 79, 255};
+    const uchar lanczos3[] = {24, 61, 120, 255, 133, 190, 154, 255, 176, 125, 38, 255,
+                              58, 110, 156, 255, 182, 175, 190, 255, 102, 75, 74, 255};
+    QTest::newRow("box") << ResampleFilter::Box
+                         << QByteArray(reinterpret_cast<const char*>(box), sizeof(box));
+    QTest::newRow("bilinear") << ResampleFilter::Bilinear
+                              << QByteArray(reinterpret_cast<const char*>(bilinear), sizeof(bilinear));
+    QTest::newRow("lanczos3") << ResampleFilter::Lanczos3
+                              << QByteArray(reinterpret_cast<const char*>(lanczos3), sizeof(lanczos3));
+}
+
+void TestResampler::golden()
+{
+    QFETCH(ResampleFilter, filter);
+    QFETCH(QByteArray, expected);
+
+    const QSize srcSize(5, 3);
+    std::vector<uchar> src(size_t(srcSize.width()) * srcSize.height() * 4);
+    for (int y = 0; y < srcSize.height(); ++y) {
+        for (int x = 0; x < srcSize.width(); ++x) {
+            for (int c = 0; c < 4; ++c) {
+                src[(y * srcSize.width() + x) * 4 + c] = c == 3 ? 255 : uchar((x * 60 + y * 25 + c * 40) % 256);
+            }
+        }
+    }
+
+    QCOMPARE(bytes(resample(src, srcSize, srcSize.width() * 4, QSize(3, 2), filter, Resampler::Isa::Scalar)),
+             expected);
+    QCOMPARE(bytes(resample(src, srcSize, srcSize.width() * 4, QSize(3, 2), filter, Resampler::Isa::Auto)),
+             expected);
+}
+
+void TestResampler::premultipliedEdge_data()
+{
+    QTest::addColumn<QSize>("dstSize");
+
+    // Odd widths leave pixels for the SIMD kernels' scalar tails
+    QTest::newRow("down") << QSize(7, 5);
+    QTest::newRow("up") << QSize(37, 29);
+}
+
+void TestResampler::premultipliedEdge()
+{
+    QFETCH(QSize, dstSize);
+
+    // Opaque black meeting half-transparent white: Lanczos3's negative
+    // lobes push colour above alpha next to the edge
+    QImage image(16, 12, QImage::Format_ARGB32_Premultiplied);
+    for (int y = 0; y < image.height(); ++y) {
+        QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < image.width(); ++x) {
+            bool translucent = x >= image.width() / 2 || y >= image.height() / 2;
+            line[x] = translucent ? qRgba(128, 128, 128, 128) : qRgba(0, 0, 0, 255);
+        }
+    }
+
+    QImage scalar = Resampler::scaled(image, dstSize, ResampleFilter::Lanczos3, Resampler::Isa::Scalar);
+    QCOMPARE(scalar.format(), QImage::Format_ARGB32_Premultiplied);
+    for (int y = 0; y < scalar.height(); ++y) {
+        const QRgb* line = reinterpret_cast<const QRgb*>(scalar.constScanLine(y));
+        for (int x = 0; x < scalar.width(); ++x) {
+            int alpha = qAlpha(line[x]);
+            if (qRed(line[x]) > alpha || qGreen(line[x]) > alpha || qBlue(line[x]) > alpha) {
+                QFAIL(qPrintable(QString("Pixel (%1, %2) has colour above alpha").arg(x).arg(y)));
+            }
+        }
+    }
+
+    QCOMPARE(Resampler::scaled(image, dstSize, ResampleFilter::Lanczos3, Resampler::Isa::Auto), scalar);
+}
+
+QTEST_GUILESS_MAIN(TestResampler)
+#include "test_resampler.moc"
@@ -0,0 +1,100 @@
+#include <QDBusMessage>
+#include <QDateTime>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+#include "core/split_cache.h"
+#include "core/wallpaper_applier.h"
+
+using WallpaperCore::MonitorInfo;
+using WallpaperCore::MonitorList;
+
+namespace {
+
+// Answers every script at once instead of talking to plasmashell
+class FakeApplier : public WallpaperCore::WallpaperApplier {
+public:
+    int scriptCalls = 0;
+
+protected:
+    QDBusPendingCall runScript(const QString&) override
+    {
+        ++scriptCalls;
+        QDBusMessage call = QDBusMessage::createMethodCall("org.kde.plasmashell", "/PlasmaShell",
+                                                           "org.kde.PlasmaShell", "evaluateScript");
+        return QDBusPendingCall::fromCompletedCall(call.createReply(QString()));
+    }
+};
+
+MonitorInfo makeMonitor(const QString& name, const QRect& geometry, const QString& wallpaperPath)
+{
+    MonitorInfo monitor;
+    monitor.name = name;
+    monitor.geometry = geometry;
+    monitor.actualResolution = geometry.size();
+    monitor.wallpaperPath = wallpaperPath;
+    return monitor;
+}
+
+} // namespace
+
+class TestWallpaperApplier : public QObject {
+    Q_OBJECT
+
+private slots:
+    void cachedSplitIsAppliedOnce();
+    void changedMonitorIsReapplied();
+};
+
+void TestWallpaperApplier::cachedSplitIsAppliedOnce()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    WallpaperCore::SplitCache cache(dir.path());
+    const QString key = WallpaperCore::SplitCache::keyFor("source");
+    MonitorList monitors;
+    for (int i = 0; i < 2; ++i) {
+        QString path = cache.outputPath(key, i, "jpg");
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write("pixels");
+        file.setFileTime(QDateTime::currentDateTime().addDays(-1), QFileDevice::FileModificationTime);
+        file.close();
+        monitors.push_back(makeMonitor(QString("DP-%1").arg(i), QRect(i * 1920, 0, 1920, 1080), path));
+    }
+
+    FakeApplier applier;
+    QVERIFY(applier.applyWallpapers(monitors));
+    QCOMPARE(applier.scriptCalls, 1);
+
+    // A cache hit on the same split touches its files for the LRU order
+    QCOMPARE(cache.lookup(key, 2, "jpg").size(), 2);
+    QVERIFY(applier.applyWallpapers(monitors));
+    QCOMPARE(applier.scriptCalls, 1);
+}
+
+void TestWallpaperApplier::changedMonitorIsReapplied()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    WallpaperCore::SplitCache cache(dir.path());
+    const QString first = WallpaperCore::SplitCache::keyFor("first");
+    const QString second = WallpaperCore::SplitCache::keyFor("second");
+    for (const QString& key : {first, second}) {
+        QFile file(cache.outputPath(key, 0, "jpg"));
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write("pixels");
+    }
+
+    MonitorList monitors{makeMonitor("DP-0", QRect(0, 0, 1920, 1080), cache.outputPath(first, 0, "jpg"))};
+    FakeApplier applier;
+    QVERIFY(applier.applyWallpapers(monitors));
+    monitors[0].wallpaperPath = cache.outputPath(second, 0, "jpg");
+    QVERIFY(applier.applyWallpapers(monitors));
+    QCOMPARE(applier.scriptCalls, 2);
+}
+
+QTEST_GUILESS_MAIN(TestWallpaperApplier)
+#include "test_wallpaper_applier.moc"